@@ -9,10 +9,10 @@ class LLANFCConan(ConanFile):
     url = "https://github.com/islog/liblogicalaccess-libnfc"
     description = "LibLogicalAccess plugin to use NFC readers supported by LibNFC project"
     settings = "os", "compiler", "build_type", "arch"
-    requires = 'LibNFC/1.7.1@cis/stable'
+    requires = 'LibNFC/1.7.1.4@cis/stable'
     generators = "cmake"
-    options = {}
-    default_options = ''
+    options = {'build_benchmark': [True, False], 'shared_readers': [True, False]}
+    default_options = 'build_benchmark=False', 'shared_readers=False'
     revision_mode = "scm"
     exports_sources = "CMakeLists.txt", "cmake*", "plugins*" 
 
@@ -22,6 +22,17 @@ class LLANFCConan(ConanFile):
         except ConanException:
             self.requires('LogicalAccess/' + self.version + '@islog/' + tools.Git().get_branch())
     
+    def configure(self):
+        if self.options.shared_readers:
+            if self.settings.os != 'Linux':
+                raise ConanException('shared_readers is only available on Linux')
+            self.options['LibNFC'].shared_driver = True
+        if self.options.build_benchmark:
+            if self.settings.os == 'Windows':
+                raise ConanException('build_benchmark needs the LibNFC sim driver, not available on Windows')
+            # Without the simulated PN53x every polling benchmark is skipped
+            self.options['LibNFC'].sim_driver = True
+
     def configure_cmake(self):
         cmake = CMake(self)
         if tools.os_info.is_windows:
@@ -31,6 +42,8 @@ class LLANFCConan(ConanFile):
         cmake.definitions['LIBLOGICALACCESS_VERSION_STRING'] = self.version
         cmake.definitions['LIBLOGICALACCESS_WINDOWS_VERSION'] = self.version.replace('.', ',') + ',0'
         cmake.definitions['TARGET_ARCH'] = self.settings.arch
+        cmake.definitions['LLA_NFC_BUILD_BENCHMARK'] = self.options.build_benchmark
+        cmake.definitions['LLA_NFC_SHARED_READERS'] = self.options.shared_readers
         cmake.configure()
         return cmake
 
@@ -44,3 +57,5 @@ class LLANFCConan(ConanFile):
 
     def package_info(self):
         self.cpp_info.libs.append('libnfc-nfcreaders')
+        if self.options.shared_readers:
+            self.cpp_info.defines.append('LLA_NFC_SHARED_READERS')
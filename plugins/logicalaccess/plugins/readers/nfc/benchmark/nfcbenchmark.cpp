@@ -0,0 +1,1464 @@
+/**
+ * \file nfcbenchmark.cpp
+ * \brief Benchmark of the NFC reader stack without any reader attached.
+ *
+ * Commands go through NFCReaderCardAdapter and an NFCDataTransport whose
+ * send() is answered in-process by a model of a Mifare Classic, Mifare
+ * Ultralight or DESFire card. Polling and card emulation go through a libnfc
+ * built with the "sim" driver. Results are printed on stdout as JSON.
+ */
+
+#include <logicalaccess/plugins/readers/nfc/nfcreaderprovider.hpp>
+#include <logicalaccess/plugins/readers/nfc/nfcreaderunit.hpp>
+#include <logicalaccess/plugins/readers/nfc/nfcdatatransport.hpp>
+#include <logicalaccess/plugins/readers/nfc/readercardadapters/nfcreadercardadapter.hpp>
+#include <logicalaccess/plugins/readers/iso7816/iso7816resultchecker.hpp>
+#include <logicalaccess/plugins/readers/iso7816/commands/desfireiso7816resultchecker.hpp>
+#include <logicalaccess/plugins/llacommon/logs.hpp>
+#include <logicalaccess/plugins/llacommon/settings.hpp>
+#include <logicalaccess/cards/commands.hpp>
+#include <logicalaccess/myexception.hpp>
+#include <logicalaccess/bufferhelper.hpp>
+#include <nfc/nfc.h>
+#include <nfc/nfc-emulation.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef NFCBENCHMARK_VERSION
+#define NFCBENCHMARK_VERSION "unknown"
+#endif
+
+// Every allocation of the process is counted, the benchmarks report the
+// allocations done between their start and end divided by their iterations.
+static std::atomic<unsigned long long> g_allocations(0);
+
+void *operator new(std::size_t size)
+{
+    ++g_allocations;
+    void *p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace logicalaccess
+{
+namespace benchmark
+{
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * \brief RF timings applied by the loopback transport to each exchange.
+ */
+struct RfLatency
+{
+    unsigned int exchange_us = 0;
+    unsigned int byte_us     = 0;
+};
+
+/**
+ * \brief A card answering the frames NFCDataTransport would transceive.
+ */
+class CardModel
+{
+  public:
+    virtual ~CardModel()
+    {
+    }
+
+    /**
+     * \brief Get the model name, as printed in the results.
+     */
+    virtual std::string getName() const = 0;
+
+    /**
+     * \brief Get the card type NFCReaderUnit gives to such a card.
+     */
+    virtual std::string getCardType() const = 0;
+
+    /**
+     * \brief Get the lines describing the card in a sim driver profile.
+     */
+    virtual std::string getSimProfile() const = 0;
+
+    /**
+     * \brief Get the command sent when measuring a single APDU.
+     */
+    virtual std::vector<unsigned char> getSampleCommand() const = 0;
+
+    /**
+     * \brief Get the result checker NFCReaderUnit would set for this card.
+     */
+    virtual std::shared_ptr<ResultChecker> createResultChecker() const
+    {
+        return std::make_shared<ISO7816ResultChecker>();
+    }
+
+    /**
+     * \brief Answer a frame.
+     * \param command The frame sent to the card.
+     * \param response The card answer.
+     * \return False if the card does not answer, as a timeout on air.
+     */
+    virtual bool transceive(const std::vector<unsigned char> &command,
+                            std::vector<unsigned char> &response) = 0;
+
+    /**
+     * \brief Read the whole card memory the way an application would.
+     * \param rca The adapter to send the commands through.
+     * \return The number of data bytes read.
+     */
+    virtual size_t readCard(ReaderCardAdapter &rca) = 0;
+};
+
+/**
+ * \brief Mifare Classic 1K, through the frames of MifareNFCCommands.
+ */
+class MifareClassicModel : public CardModel
+{
+  public:
+    MifareClassicModel()
+        : d_memory(1024)
+    {
+        for (size_t i = 0; i < d_memory.size(); ++i)
+            d_memory[i] = static_cast<unsigned char>(i);
+    }
+
+    std::string getName() const override
+    {
+        return "mifare_classic_1k";
+    }
+
+    std::string getCardType() const override
+    {
+        return "Mifare1K";
+    }
+
+    std::string getSimProfile() const override
+    {
+        return "target.uid = DE AD BE EF\n"
+               "target.atqa = 00 04\n"
+               "target.sak = 08\n"
+               "target.exchange = 30 : 40 41 42 43 44 45 46 47 48 49 4A 4B 4C 4D 4E 4F\n";
+    }
+
+    std::vector<unsigned char> getSampleCommand() const override
+    {
+        return {0x30, 0x04};
+    }
+
+    bool transceive(const std::vector<unsigned char> &command,
+                    std::vector<unsigned char> &response) override
+    {
+        if (command.size() == 12 && (command[0] == 0x60 || command[0] == 0x61))
+        {
+            response.clear();
+            return true;
+        }
+        if (command.size() == 2 && command[0] == 0x30 && command[1] < 64)
+        {
+            response.assign(d_memory.begin() + command[1] * 16,
+                            d_memory.begin() + command[1] * 16 + 16);
+            return true;
+        }
+        if (command.size() == 18 && command[0] == 0xA0 && command[1] < 64)
+        {
+            std::copy(command.begin() + 2, command.end(),
+                      d_memory.begin() + command[1] * 16);
+            response.clear();
+            return true;
+        }
+        return false;
+    }
+
+    size_t readCard(ReaderCardAdapter &rca) override
+    {
+        size_t len = 0;
+        for (unsigned char sector = 0; sector < 16; ++sector)
+        {
+            std::vector<unsigned char> auth = {
+                0x60, static_cast<unsigned char>(sector * 4), 0xFF, 0xFF, 0xFF,
+                0xFF, 0xFF, 0xFF, 0xDE, 0xAD, 0xBE, 0xEF};
+            rca.sendCommand(auth);
+            for (unsigned char block = 0; block < 4; ++block)
+            {
+                std::vector<unsigned char> read = {
+                    0x30, static_cast<unsigned char>(sector * 4 + block)};
+                len += rca.sendCommand(read).size();
+            }
+        }
+        return len;
+    }
+
+  private:
+    std::vector<unsigned char> d_memory;
+};
+
+/**
+ * \brief Mifare Ultralight, READ returns four pages.
+ */
+class MifareUltralightModel : public CardModel
+{
+  public:
+    MifareUltralightModel()
+        : d_memory(64)
+    {
+        for (size_t i = 0; i < d_memory.size(); ++i)
+            d_memory[i] = static_cast<unsigned char>(i);
+    }
+
+    std::string getName() const override
+    {
+        return "mifare_ultralight";
+    }
+
+    std::string getCardType() const override
+    {
+        return "MifareUltralight";
+    }
+
+    std::string getSimProfile() const override
+    {
+        return "target.uid = 04 11 22 33 44 55 66\n"
+               "target.atqa = 00 44\n"
+               "target.sak = 00\n"
+               "target.exchange = 30 : 10 11 12 13 14 15 16 17 18 19 1A 1B 1C 1D 1E 1F\n";
+    }
+
+    std::vector<unsigned char> getSampleCommand() const override
+    {
+        return {0x30, 0x04};
+    }
+
+    bool transceive(const std::vector<unsigned char> &command,
+                    std::vector<unsigned char> &response) override
+    {
+        if (command.size() == 2 && command[0] == 0x30 && command[1] < 16)
+        {
+            response.resize(16);
+            for (size_t i = 0; i < 16; ++i)
+                response[i] = d_memory[(command[1] * 4 + i) % d_memory.size()];
+            return true;
+        }
+        return false;
+    }
+
+    size_t readCard(ReaderCardAdapter &rca) override
+    {
+        size_t len = 0;
+        for (unsigned char page = 0; page < 16; page += 4)
+        {
+            std::vector<unsigned char> read = {0x30, page};
+            len += rca.sendCommand(read).size();
+        }
+        return len;
+    }
+
+  private:
+    std::vector<unsigned char> d_memory;
+};
+
+/**
+ * \brief DESFire EV1 with native commands wrapped in ISO 7816 APDUs.
+ */
+class DESFireModel : public CardModel
+{
+  public:
+    DESFireModel()
+        : d_file(256)
+        , d_pending(0)
+        , d_pendingOffset(0)
+        , d_versionFrame(0)
+    {
+        for (size_t i = 0; i < d_file.size(); ++i)
+            d_file[i] = static_cast<unsigned char>(i);
+    }
+
+    std::string getName() const override
+    {
+        return "desfire_ev1";
+    }
+
+    std::string getCardType() const override
+    {
+        return "DESFireEV1";
+    }
+
+    std::string getSimProfile() const override
+    {
+        return "target.uid = 04 A1 B2 C3 D4 E5 F6\n"
+               "target.atqa = 03 44\n"
+               "target.sak = 20\n"
+               "target.ats = 75 77 81 02 80\n"
+               "target.default = 91 00\n";
+    }
+
+    std::vector<unsigned char> getSampleCommand() const override
+    {
+        // SelectApplication 0x000001
+        return {0x90, 0x5A, 0x00, 0x00, 0x03, 0x01, 0x00, 0x00, 0x00};
+    }
+
+    std::shared_ptr<ResultChecker> createResultChecker() const override
+    {
+        return std::make_shared<DESFireISO7816ResultChecker>();
+    }
+
+    bool transceive(const std::vector<unsigned char> &command,
+                    std::vector<unsigned char> &response) override
+    {
+        if (command.size() < 5 || command[0] != 0x90)
+            return false;
+
+        response.clear();
+        switch (command[1])
+        {
+        case 0x60:
+            d_versionFrame = 0;
+            return sendVersionFrame(response);
+        case 0x5A:
+            d_versionFrame = 0;
+            response       = {0x91, 0x00};
+            return true;
+        case 0xBD:
+            d_versionFrame = 0;
+            if (command.size() < 13 || command[5] != 0x01)
+            {
+                response = {0x91, 0xF0};
+                return true;
+            }
+            d_pendingOffset =
+                command[6] | (command[7] << 8) | (static_cast<size_t>(command[8]) << 16);
+            d_pending = command[9] | (command[10] << 8) |
+                        (static_cast<size_t>(command[11]) << 16);
+            if (d_pending == 0 || d_pendingOffset + d_pending > d_file.size())
+                d_pending = d_file.size() - std::min(d_pendingOffset, d_file.size());
+            return sendReadFrame(response);
+        case 0xAF:
+            if (d_versionFrame > 0 && d_versionFrame < 3)
+                return sendVersionFrame(response);
+            if (d_pending > 0)
+                return sendReadFrame(response);
+            response = {0x91, 0xCA};
+            return true;
+        default: response = {0x91, 0x1C}; return true;
+        }
+    }
+
+    size_t readCard(ReaderCardAdapter &rca) override
+    {
+        rca.sendCommand(getSampleCommand());
+
+        // ReadData of the whole standard file 1, in 59 bytes frames
+        std::vector<unsigned char> readData = {0x90, 0xBD, 0x00, 0x00, 0x07, 0x01, 0x00,
+                                               0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+        std::vector<unsigned char> more = {0x90, 0xAF, 0x00, 0x00, 0x00};
+        size_t len                      = 0;
+        std::vector<unsigned char> res  = rca.sendCommand(readData);
+        while (res.size() >= 2)
+        {
+            len += res.size() - 2;
+            if (res[res.size() - 1] != 0xAF)
+                break;
+            res = rca.sendCommand(more);
+        }
+        return len;
+    }
+
+  private:
+    bool sendVersionFrame(std::vector<unsigned char> &response)
+    {
+        static const unsigned char hardware[]   = {0x04, 0x01, 0x01, 0x01,
+                                                   0x00, 0x1A, 0x05};
+        static const unsigned char software[]   = {0x04, 0x01, 0x01, 0x01,
+                                                   0x04, 0x1A, 0x05};
+        static const unsigned char production[] = {0x04, 0xA1, 0xB2, 0xC3, 0xD4,
+                                                   0xE5, 0xF6, 0xBA, 0x34, 0xCD,
+                                                   0x4A, 0x90, 0x37, 0x12};
+        switch (d_versionFrame++)
+        {
+        case 0: response.assign(hardware, hardware + sizeof(hardware)); break;
+        case 1: response.assign(software, software + sizeof(software)); break;
+        default: response.assign(production, production + sizeof(production)); break;
+        }
+        response.push_back(0x91);
+        response.push_back(d_versionFrame < 3 ? 0xAF : 0x00);
+        return true;
+    }
+
+    bool sendReadFrame(std::vector<unsigned char> &response)
+    {
+        size_t len = std::min<size_t>(d_pending, 59);
+        response.assign(d_file.begin() + d_pendingOffset,
+                        d_file.begin() + d_pendingOffset + len);
+        d_pendingOffset += len;
+        d_pending -= len;
+        response.push_back(0x91);
+        response.push_back(d_pending > 0 ? 0xAF : 0x00);
+        return true;
+    }
+
+    std::vector<unsigned char> d_file;
+    size_t d_pending;
+    size_t d_pendingOffset;
+    unsigned int d_versionFrame;
+};
+
+/**
+ * \brief NFC data transport looping the frames back to a card model.
+ *
+ * Only send() is replaced: receive() and sendCommand() are NFCDataTransport
+ * ones, so their logging and copies are part of the measures.
+ */
+class LoopbackDataTransport : public NFCDataTransport
+{
+  public:
+    LoopbackDataTransport(std::shared_ptr<CardModel> card, const RfLatency &latency)
+        : d_card(card)
+        , d_latency(latency)
+    {
+        d_isConnected = true;
+    }
+
+    bool connect() override
+    {
+        d_isConnected = true;
+        return true;
+    }
+
+    void disconnect() override
+    {
+        d_isConnected = false;
+    }
+
+    bool isConnected() override
+    {
+        return d_isConnected;
+    }
+
+    std::string getName() const override
+    {
+        return "loopback:" + d_card->getName();
+    }
+
+    void send(const std::vector<unsigned char> &data) override
+    {
+        if (data.size() > 0)
+        {
+            LOG(LogLevel::COMS) << "APDU command: " << BufferHelper::getHex(data);
+
+            bool answered = d_card->transceive(data, d_response);
+            spendRfTime(data.size() + (answered ? d_response.size() : 0));
+            if (!answered)
+            {
+                d_response.clear();
+                if (!ignore_error_)
+                    CheckNFCError(NFC_ERFTRANS);
+            }
+            else
+            {
+                LOG(DEBUGS) << "Received " << d_response.size()
+                            << " bytes from the NFC reader.";
+            }
+        }
+    }
+
+  private:
+    /**
+     * \brief Wait the time the exchange would take on air.
+     *
+     * Busy waiting: sleeping would round sub-millisecond latencies up to the
+     * scheduler granularity.
+     */
+    void spendRfTime(size_t bytes) const
+    {
+        unsigned long long us = d_latency.exchange_us + d_latency.byte_us * bytes;
+        if (us == 0)
+            return;
+
+        Clock::time_point until = Clock::now() + std::chrono::microseconds(us);
+        while (Clock::now() < until)
+        {
+        }
+    }
+
+    std::shared_ptr<CardModel> d_card;
+    RfLatency d_latency;
+};
+
+/**
+ * \brief Benchmark options, from the command line.
+ */
+struct Options
+{
+    unsigned int iterations = 10000;
+    unsigned int read_iterations = 200;
+    unsigned int poll_iterations = 50;
+    unsigned int inventory_tags  = 40;
+    unsigned int emulate_transactions = 200;
+    unsigned int idle_ms              = 2000;
+    unsigned int sim_iterations       = 1000;
+    RfLatency latency;
+    std::string filter;
+    std::string log_file;
+    bool poll    = true;
+    bool emulate = true;
+};
+
+/**
+ * \brief Measures of one benchmark.
+ */
+struct Result
+{
+    std::string name;
+    std::string card;
+    unsigned int iterations = 0;
+    double mean_ns          = 0;
+    long long min_ns        = 0;
+    long long p50_ns        = 0;
+    long long p99_ns        = 0;
+    double allocs_per_op    = 0;
+    double bytes_per_s      = 0;
+    double tags_per_s       = 0;
+    // Waiting for cards: polls per second, share of the time spent exchanging with
+    // the reader and CPU load of the waiting thread
+    double polls_per_s      = 0;
+    double bus_utilisation  = 0;
+    double cpu_utilisation  = 0;
+    // Response time profiling: mean card, reader and bus time of the samples
+    bool profiled           = false;
+    long long card_ns       = 0;
+    long long reader_ns     = 0;
+    long long bus_ns        = 0;
+    long long max_ns        = 0;
+    // Latency histogram of the emulation benchmarks, bucket n below 2^n us
+    std::vector<unsigned int> histogram;
+    std::string skipped;
+};
+
+/**
+ * \brief Fill the statistics of a result from its samples.
+ */
+static void summarize(Result &result, std::vector<long long> &samples, long long total,
+                      unsigned long long allocs)
+{
+    result.iterations = static_cast<unsigned int>(samples.size());
+    if (samples.empty())
+        return;
+
+    std::sort(samples.begin(), samples.end());
+    size_t p99           = std::min(samples.size() - 1, samples.size() * 99 / 100);
+    result.mean_ns       = static_cast<double>(total) / samples.size();
+    result.min_ns        = samples.front();
+    result.p50_ns        = samples[samples.size() / 2];
+    result.p99_ns        = samples[p99];
+    result.allocs_per_op = static_cast<double>(allocs) / samples.size();
+}
+
+static Result measure(const std::string &name, const std::string &card,
+                      unsigned int iterations, const std::function<size_t()> &op)
+{
+    Result result;
+    result.name = name;
+    result.card = card;
+
+    // Warm up caches and lazily allocated buffers
+    for (unsigned int i = 0; i < std::min(iterations, 10u); ++i)
+        op();
+
+    std::vector<long long> samples;
+    samples.reserve(iterations);
+    // Only throughput benchmarks count bytes, op() returns 0 otherwise
+    size_t bytes                    = 0;
+    unsigned long long allocsBefore = g_allocations.load();
+    Clock::time_point begin         = Clock::now();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        Clock::time_point start = Clock::now();
+        bytes += op();
+        samples.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start)
+                .count());
+    }
+    // samples.push_back() never reallocates, reserve() was done before
+    unsigned long long allocs = g_allocations.load() - allocsBefore;
+    long long total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          Clock::now() - begin)
+                          .count();
+
+    summarize(result, samples, total, allocs);
+    if (total > 0)
+        result.bytes_per_s = bytes * 1e9 / total;
+    return result;
+}
+
+static bool selected(const Options &options, std::shared_ptr<CardModel> card,
+                     const std::string &name)
+{
+    return options.filter.empty() ||
+           (card->getName() + "/" + name).find(options.filter) != std::string::npos;
+}
+
+/**
+ * \brief Measure a single command at each layer of the stack.
+ *
+ * The difference between two consecutive layers is the overhead the upper
+ * one adds: NFCDataTransport::sendCommand, NFCReaderCardAdapter::sendCommand,
+ * then the result checker. Each is measured with and without logging.
+ */
+static void benchmarkApdu(const Options &options, std::shared_ptr<CardModel> card,
+                          std::vector<Result> &results)
+{
+    std::vector<unsigned char> command = card->getSampleCommand();
+    std::shared_ptr<LoopbackDataTransport> dt =
+        std::make_shared<LoopbackDataTransport>(card, options.latency);
+    NFCReaderCardAdapter rca;
+    rca.setDataTransport(dt);
+    NFCReaderCardAdapter checkedRca;
+    checkedRca.setDataTransport(dt);
+    checkedRca.setResultChecker(card->createResultChecker());
+
+    for (int logging = 1; logging >= 0; --logging)
+    {
+        std::unique_ptr<LogDisabler> disabler;
+        if (!logging)
+            disabler.reset(new LogDisabler());
+        std::string suffix = logging ? "" : "/nolog";
+
+        if (selected(options, card, "apdu/model" + suffix))
+        {
+            std::vector<unsigned char> response;
+            results.push_back(measure("apdu/model" + suffix, card->getName(),
+                                      options.iterations, [&]() {
+                                          card->transceive(command, response);
+                                          return 0;
+                                      }));
+        }
+        if (selected(options, card, "apdu/transport" + suffix))
+        {
+            results.push_back(measure("apdu/transport" + suffix, card->getName(),
+                                      options.iterations, [&]() {
+                                          dt->sendCommand(command);
+                                          return 0;
+                                      }));
+        }
+        if (selected(options, card, "apdu/adapter" + suffix))
+        {
+            results.push_back(measure("apdu/adapter" + suffix, card->getName(),
+                                      options.iterations, [&]() {
+                                          rca.sendCommand(command);
+                                          return 0;
+                                      }));
+        }
+        if (selected(options, card, "apdu/checked" + suffix))
+        {
+            results.push_back(measure("apdu/checked" + suffix, card->getName(),
+                                      options.iterations, [&]() {
+                                          checkedRca.sendCommand(command);
+                                          return 0;
+                                      }));
+        }
+    }
+}
+
+/**
+ * \brief Measure the read of the whole card memory, with logging disabled.
+ */
+static void benchmarkRead(const Options &options, std::shared_ptr<CardModel> card,
+                          std::vector<Result> &results)
+{
+    if (!selected(options, card, "read"))
+        return;
+
+    std::shared_ptr<LoopbackDataTransport> dt =
+        std::make_shared<LoopbackDataTransport>(card, options.latency);
+    NFCReaderCardAdapter rca;
+    rca.setDataTransport(dt);
+    rca.setResultChecker(card->createResultChecker());
+
+    LogDisabler disabler;
+    results.push_back(measure("read", card->getName(), options.read_iterations,
+                              [&]() { return card->readCard(rca); }));
+}
+
+/**
+ * \brief Measure the time waitInsertion() takes to return a chip.
+ *
+ * Polling needs a libnfc device: this uses the sim driver with a profile
+ * holding the card alone. A fresh reader unit is opened for each iteration,
+ * outside of the measure, since the chip list of a unit only grows.
+ */
+static void benchmarkPoll(const Options &options, std::shared_ptr<CardModel> card,
+                          std::vector<Result> &results)
+{
+    if (!options.poll || !selected(options, card, "poll"))
+        return;
+
+    Result skipped;
+    skipped.name = "poll";
+    skipped.card = card->getName();
+
+    std::string profile = "nfcbenchmark-" + card->getName() + ".conf";
+    {
+        std::ofstream out(profile.c_str());
+        out << "chip = pn533\n"
+            << "rf.exchange_us = " << options.latency.exchange_us << "\n"
+            << "rf.byte_us = " << options.latency.byte_us << "\n"
+            << card->getSimProfile();
+        if (!out)
+        {
+            skipped.skipped = "cannot write the sim profile";
+            results.push_back(skipped);
+            return;
+        }
+    }
+
+    try
+    {
+        std::shared_ptr<NFCReaderProvider> provider = NFCReaderProvider::createInstance();
+        LogDisabler disabler;
+
+        std::vector<long long> samples;
+        unsigned long long allocs = 0;
+        long long total           = 0;
+        for (unsigned int i = 0; i < options.poll_iterations && skipped.skipped.empty();
+             ++i)
+        {
+            std::shared_ptr<NFCReaderUnit> unit =
+                NFCReaderUnit::createNFCReaderUnit("sim:" + profile);
+            unit->setReaderProvider(std::weak_ptr<ReaderProvider>(provider));
+            if (!unit->connectToReader())
+            {
+                skipped.skipped = "libnfc has no sim driver";
+                break;
+            }
+
+            unsigned long long allocsBefore = g_allocations.load();
+            Clock::time_point start         = Clock::now();
+            bool inserted                   = unit->waitInsertion(1000);
+            long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               Clock::now() - start)
+                               .count();
+            allocs += g_allocations.load() - allocsBefore;
+
+            if (!inserted || unit->getSingleChip()->getCardType() != card->getCardType())
+                skipped.skipped = "the sim driver did not report the card";
+            samples.push_back(ns);
+            total += ns;
+            unit->disconnectFromReader();
+        }
+
+        if (skipped.skipped.empty() && !samples.empty())
+        {
+            Result result = skipped;
+            summarize(result, samples, total, allocs);
+            results.push_back(result);
+        }
+        else
+        {
+            results.push_back(skipped);
+        }
+    }
+    catch (std::exception &e)
+    {
+        skipped.skipped = e.what();
+        results.push_back(skipped);
+    }
+    std::remove(profile.c_str());
+}
+
+/**
+ * \brief Measure a single command through the sim driver, with and without the
+ * response time profiling.
+ *
+ * The profiled run times every exchange, its overhead over the plain run is the
+ * cost of a sample. The card, reader and bus times are the means of the samples.
+ */
+static void benchmarkProfile(const Options &options, std::shared_ptr<CardModel> card,
+                             std::vector<Result> &results)
+{
+    const char *const names[] = {"apdu/sim", "apdu/sim/profiled"};
+    if (!options.poll)
+        return;
+
+    std::string profile = "nfcbenchmark-" + card->getName() + "-profile.conf";
+    {
+        std::ofstream out(profile.c_str());
+        out << "chip = pn533\n"
+            << "rf.exchange_us = " << options.latency.exchange_us << "\n"
+            << "rf.byte_us = " << options.latency.byte_us << "\n"
+            << card->getSimProfile();
+    }
+
+    std::shared_ptr<NFCReaderProvider> provider;
+    for (int profiled = 0; profiled < 2; ++profiled)
+    {
+        Result result;
+        result.name = names[profiled];
+        result.card = card->getName();
+        if (!selected(options, card, result.name))
+            continue;
+
+        try
+        {
+            if (!provider)
+                provider = NFCReaderProvider::createInstance();
+            LogDisabler disabler;
+            std::shared_ptr<NFCReaderUnit> unit =
+                NFCReaderUnit::createNFCReaderUnit("sim:" + profile);
+            unit->setReaderProvider(std::weak_ptr<ReaderProvider>(provider));
+            if (!unit->connectToReader())
+            {
+                result.skipped = "libnfc has no sim driver";
+                results.push_back(result);
+                continue;
+            }
+            unit->getNFCConfiguration()->setResponseTimeSampling(profiled ? 1 : 0);
+
+            std::shared_ptr<NFCDataTransport> dt;
+            if (unit->waitInsertion(1000) && unit->connect())
+                dt = std::dynamic_pointer_cast<NFCDataTransport>(
+                    unit->getSingleChip()
+                        ->getCommands()
+                        ->getReaderCardAdapter()
+                        ->getDataTransport());
+            std::vector<unsigned char> command = card->getSampleCommand();
+            if (!dt)
+                result.skipped = "the sim driver did not report the card";
+            else if (!dt->trySendCommand(command))
+                result.skipped = "the sim card does not answer the sample command";
+            else
+            {
+                unit->resetResponseTimeStatistics();
+                result = measure(result.name, result.card, options.sim_iterations, [&]() {
+                    dt->trySendCommand(command);
+                    return static_cast<size_t>(0);
+                });
+
+                const std::map<std::string, NFCResponseTimeStatistics> &statistics =
+                    unit->getResponseTimeStatistics();
+                auto it = statistics.find(card->getCardType());
+                if (profiled && (it == statistics.end() || it->second.card.count == 0))
+                    result.skipped = "no response time was sampled";
+                else if (profiled)
+                {
+                    result.profiled  = true;
+                    result.card_ns   = it->second.card.mean().count() * 1000;
+                    result.reader_ns = it->second.reader.mean().count() * 1000;
+                    result.bus_ns    = it->second.bus.mean().count() * 1000;
+                }
+                unit->disconnect();
+            }
+            unit->disconnectFromReader();
+        }
+        catch (std::exception &e)
+        {
+            result.skipped = e.what();
+        }
+        results.push_back(result);
+    }
+    std::remove(profile.c_str());
+}
+
+/**
+ * \brief Measure what waiting for a card costs while no card comes.
+ *
+ * The sim driver holds a PN532 and an empty field. The reader unit waits
+ * idle_ms once polling at the poll period, then once going idle after the
+ * first empty poll, and reports its polling statistics.
+ */
+static void benchmarkIdle(const Options &options, std::vector<Result> &results)
+{
+    const char *const names[] = {"wait-active", "wait-idle"};
+    std::string profile = "nfcbenchmark-idle.conf";
+    {
+        std::ofstream out(profile.c_str());
+        out << "chip = pn532\n"
+            << "rf.exchange_us = " << options.latency.exchange_us << "\n"
+            << "rf.byte_us = " << options.latency.byte_us << "\n";
+    }
+
+    std::shared_ptr<NFCReaderProvider> provider;
+    for (int idle = 0; idle < 2; ++idle)
+    {
+        Result result;
+        result.name = names[idle];
+        result.card = "none";
+        if (!options.poll ||
+            (!options.filter.empty() &&
+             ("none/" + result.name).find(options.filter) == std::string::npos))
+            continue;
+
+        try
+        {
+            if (!provider)
+                provider = NFCReaderProvider::createInstance();
+            LogDisabler disabler;
+            std::shared_ptr<NFCReaderUnit> unit =
+                NFCReaderUnit::createNFCReaderUnit("sim:" + profile);
+            unit->setReaderProvider(std::weak_ptr<ReaderProvider>(provider));
+            if (!unit->connectToReader())
+            {
+                result.skipped = "libnfc has no sim driver";
+                results.push_back(result);
+                continue;
+            }
+            unit->getNFCConfiguration()->setIdleDelay(idle ? 1 : 0);
+
+            unsigned long long allocsBefore = g_allocations.load();
+            unit->waitInsertion(options.idle_ms);
+            unsigned long long allocs = g_allocations.load() - allocsBefore;
+
+            const NFCPollingStats &stats = unit->getPollingStats();
+            NFCPollModeStats total       = stats.active;
+            total.polls += stats.idle.polls;
+            total.elapsed += stats.idle.elapsed;
+            total.deviceTime += stats.idle.deviceTime;
+            total.cpuTime += stats.idle.cpuTime;
+            unit->disconnectFromReader();
+
+            result.iterations = static_cast<unsigned int>(total.polls);
+            if (total.polls > 0)
+            {
+                result.mean_ns =
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(total.elapsed)
+                        .count() /
+                    static_cast<double>(total.polls);
+                result.allocs_per_op = static_cast<double>(allocs) / total.polls;
+            }
+            if (total.elapsed.count() > 0)
+            {
+                double elapsed         = static_cast<double>(total.elapsed.count());
+                result.polls_per_s     = total.polls * 1e6 / elapsed;
+                result.bus_utilisation = total.deviceTime.count() / elapsed;
+                result.cpu_utilisation = total.cpuTime.count() / elapsed;
+            }
+        }
+        catch (std::exception &e)
+        {
+            result.skipped = e.what();
+        }
+        results.push_back(result);
+    }
+    std::remove(profile.c_str());
+}
+
+/**
+ * \brief Measure inventory() listing a field full of tags.
+ *
+ * The sim driver holds Mifare Classic and Ultralight tags in turn, so that
+ * single and double size UIDs are both listed.
+ */
+static void benchmarkInventory(const Options &options, std::vector<Result> &results)
+{
+    Result result;
+    result.name = "inventory";
+    result.card = std::to_string(options.inventory_tags) + "_tags";
+    if (!options.poll || options.inventory_tags == 0 ||
+        (!options.filter.empty() && result.name.find(options.filter) == std::string::npos))
+        return;
+
+    std::string profile = "nfcbenchmark-inventory.conf";
+    {
+        std::ofstream out(profile.c_str());
+        out << "chip = pn533\n"
+            << "rf.exchange_us = " << options.latency.exchange_us << "\n"
+            << "rf.byte_us = " << options.latency.byte_us << "\n"
+            << std::hex << std::uppercase << std::setfill('0');
+        for (unsigned int t = 0; t < options.inventory_tags; ++t)
+        {
+            if (t % 2)
+                out << "target.uid = 04 " << std::setw(2) << (t & 0xFF) << " "
+                    << std::setw(2) << ((t >> 8) & 0xFF) << " 33 44 55 66\n"
+                    << "target.atqa = 00 44\ntarget.sak = 00\n";
+            else
+                out << "target.uid = " << std::setw(2) << (t & 0xFF) << " " << std::setw(2)
+                    << ((t >> 8) & 0xFF) << " BE EF\n"
+                    << "target.atqa = 00 04\ntarget.sak = 08\n";
+        }
+        if (!out)
+            result.skipped = "cannot write the sim profile";
+    }
+
+    try
+    {
+        std::shared_ptr<NFCReaderProvider> provider = NFCReaderProvider::createInstance();
+        std::shared_ptr<NFCReaderUnit> unit =
+            NFCReaderUnit::createNFCReaderUnit("sim:" + profile);
+        unit->setReaderProvider(std::weak_ptr<ReaderProvider>(provider));
+        if (result.skipped.empty() && !unit->connectToReader())
+            result.skipped = "libnfc has no sim driver";
+
+        if (result.skipped.empty())
+        {
+            LogDisabler disabler;
+            size_t tags = 0;
+            result      = measure(result.name, result.card, options.poll_iterations, [&]() {
+                NFCInventoryStats stats;
+                unit->inventory(0, &stats);
+                tags += stats.tags;
+                return static_cast<size_t>(0);
+            });
+            unsigned int runs = std::min(options.poll_iterations, 10u) + result.iterations;
+            if (tags != static_cast<size_t>(options.inventory_tags) * runs)
+                result.skipped = "the sim driver did not report all the tags";
+            else if (result.mean_ns > 0)
+                result.tags_per_s = options.inventory_tags * 1e9 / result.mean_ns;
+            unit->disconnectFromReader();
+        }
+    }
+    catch (std::exception &e)
+    {
+        result.skipped = e.what();
+    }
+    std::remove(profile.c_str());
+    results.push_back(result);
+}
+
+/**
+ * \brief A NFC Forum tag served by the emulation engine of libnfc.
+ */
+struct EmulatedTag
+{
+    std::string name;
+    nfc_target target;
+    nfc_emulation_table *table = nullptr;
+    // Commands of the virtual initiator, each with the answer it expects
+    std::vector<std::pair<std::vector<unsigned char>, std::vector<unsigned char>>>
+        transaction;
+    std::string chip;
+};
+
+static EmulatedTag emulatedType2Tag()
+{
+    // NDEF URI record "example.com" in a 16-page tag
+    std::vector<unsigned char> memory = {
+        0x08, 0x11, 0x22, 0x33, 0x44, 0x00, 0x00, 0x00, 0xE1, 0x10, 0x06, 0x00, 0x03,
+        0x10, 0xD1, 0x01, 0x0C, 0x55, 0x01, 'e',  'x',  'a',  'm',  'p',  'l',  'e',
+        '.',  'c',  'o',  'm',  0xFE};
+    memory.resize(64, 0x00);
+
+    EmulatedTag tag;
+    tag.name = "type2";
+    tag.chip = "pn533";
+    std::memset(&tag.target, 0, sizeof(tag.target));
+    tag.target.nm.nmt               = NMT_ISO14443A;
+    tag.target.nm.nbr               = NBR_UNDEFINED;
+    tag.target.nti.nai.abtAtqa[1]   = 0x44;
+    tag.target.nti.nai.szUidLen     = 4;
+    std::memcpy(tag.target.nti.nai.abtUid, memory.data(), 4);
+    tag.table = nfc_emulation_table_forum_tag2(memory.data(), memory.size());
+    for (unsigned char page = 0; page < 16; page += 4)
+    {
+        tag.transaction.push_back(
+            {{0x30, page},
+             std::vector<unsigned char>(memory.begin() + page * 4,
+                                        memory.begin() + page * 4 + 16)});
+    }
+    tag.transaction.push_back({{0x50, 0x00}, {}});
+    return tag;
+}
+
+static EmulatedTag emulatedType4Tag()
+{
+    // NDEF file: NLEN then the URI record "example.com"
+    std::vector<unsigned char> ndef = {0x00, 0x10, 0xD1, 0x01, 0x0C, 0x55,
+                                       0x01, 'e',  'x',  'a',  'm',  'p',
+                                       'l',  'e',  '.',  'c',  'o',  'm'};
+    std::vector<unsigned char> cc = {0x00, 0x0F, 0x20, 0x00, 0x54, 0x00, 0xFF, 0x04,
+                                     0x06, 0xE1, 0x04, 0x00, 0x12, 0x00, 0xFF, 0x90, 0x00};
+    std::vector<unsigned char> ok = {0x90, 0x00};
+
+    EmulatedTag tag;
+    tag.name = "type4";
+    tag.chip = "pn532";
+    std::memset(&tag.target, 0, sizeof(tag.target));
+    tag.target.nm.nmt             = NMT_ISO14443A;
+    tag.target.nm.nbr             = NBR_UNDEFINED;
+    tag.target.nti.nai.abtAtqa[1] = 0x04;
+    tag.target.nti.nai.btSak      = 0x20;
+    tag.target.nti.nai.szUidLen   = 4;
+    std::memcpy(tag.target.nti.nai.abtUid, "\x08\x00\xB0\x0B", 4);
+    tag.target.nti.nai.szAtsLen = 5;
+    std::memcpy(tag.target.nti.nai.abtAts, "\x75\x33\x92\x03\x80", 5);
+    tag.table = nfc_emulation_table_forum_tag4(ndef.data(), ndef.size());
+
+    std::vector<unsigned char> nlen(ndef.begin(), ndef.begin() + 2);
+    std::vector<unsigned char> message(ndef.begin() + 2, ndef.end());
+    nlen.insert(nlen.end(), ok.begin(), ok.end());
+    message.insert(message.end(), ok.begin(), ok.end());
+    tag.transaction = {
+        {{0x00, 0xA4, 0x04, 0x00, 0x07, 0xD2, 0x76, 0x00, 0x00, 0x85, 0x01, 0x01, 0x00}, ok},
+        {{0x00, 0xA4, 0x00, 0x0C, 0x02, 0xE1, 0x03}, ok},
+        {{0x00, 0xB0, 0x00, 0x00, 0x0F}, cc},
+        {{0x00, 0xA4, 0x00, 0x0C, 0x02, 0xE1, 0x04}, ok},
+        {{0x00, 0xB0, 0x00, 0x00, 0x02}, nlen},
+        {{0x00, 0xB0, 0x00, 0x02, static_cast<unsigned char>(message.size() - 2)},
+         message}};
+    return tag;
+}
+
+/**
+ * \brief Bytes in the hexadecimal syntax of sim profiles.
+ */
+static std::string simHex(const std::vector<unsigned char> &data)
+{
+    std::ostringstream oss;
+    oss << std::hex << std::uppercase << std::setfill('0');
+    for (size_t i = 0; i < data.size(); ++i)
+        oss << (i ? " " : "") << std::setw(2) << static_cast<unsigned int>(data[i]);
+    return oss.str();
+}
+
+/**
+ * \brief Percentile of an emulation latency histogram, in nanoseconds.
+ *
+ * Only buckets are known: this is the upper bound of the bucket reaching the
+ * percentile, never above the maximum latency.
+ */
+static long long histogramPercentile(const nfc_emulation_stats &stats, unsigned int percent)
+{
+    unsigned long long total = 0;
+    for (unsigned int count : stats.latency_histogram)
+        total += count;
+
+    unsigned long long count = 0;
+    for (size_t n = 0; n < NFC_EMULATION_LATENCY_BUCKETS; ++n)
+    {
+        count += stats.latency_histogram[n];
+        if (count * 100 >= total * percent)
+            return std::min<long long>(1LL << n, stats.latency_max_us) * 1000;
+    }
+    return static_cast<long long>(stats.latency_max_us) * 1000;
+}
+
+/**
+ * \brief Measure libnfc answering a reader as an emulated NFC Forum tag.
+ *
+ * The sim driver plays a reader reading the whole tag in each transaction,
+ * nfc_emulate_target_table() answers from the precomputed table of the tag.
+ * Latencies are measured by libnfc, from request received to response sent.
+ */
+static void benchmarkEmulate(const Options &options, std::vector<Result> &results)
+{
+    std::vector<EmulatedTag> tags = {emulatedType2Tag(), emulatedType4Tag()};
+    for (EmulatedTag &tag : tags)
+    {
+        Result result;
+        result.name = "emulate/" + tag.name;
+        result.card = tag.name;
+        // Without a limit, the virtual initiator would never leave
+        if (!options.emulate || options.emulate_transactions == 0 ||
+            (!options.filter.empty() && result.name.find(options.filter) == std::string::npos))
+        {
+            nfc_emulation_table_free(tag.table);
+            continue;
+        }
+
+        size_t answered = 0;
+        std::string profile = "nfcbenchmark-emulate-" + tag.name + ".conf";
+        {
+            std::ofstream out(profile.c_str());
+            out << "chip = " << tag.chip << "\n"
+                << "rf.exchange_us = " << options.latency.exchange_us << "\n"
+                << "rf.byte_us = " << options.latency.byte_us << "\n"
+                << "initiator.transactions = " << options.emulate_transactions << "\n";
+            for (const auto &exchange : tag.transaction)
+            {
+                out << "initiator.command = " << simHex(exchange.first);
+                if (!exchange.second.empty())
+                {
+                    out << " : " << simHex(exchange.second);
+                    ++answered;
+                }
+                out << "\n";
+            }
+            if (!out)
+                result.skipped = "cannot write the sim profile";
+        }
+        if (!tag.table && result.skipped.empty())
+            result.skipped = "cannot build the emulation table";
+
+        nfc_context *context = nullptr;
+        nfc_device *device   = nullptr;
+        if (result.skipped.empty() && tag.table)
+        {
+            nfc_init(&context);
+            if (context)
+                device = nfc_open(context, ("sim:" + profile).c_str());
+        }
+        if (!device && result.skipped.empty())
+            result.skipped = "libnfc has no sim driver";
+
+        if (device)
+        {
+            nfc_emulation_stats stats;
+            unsigned long long allocsBefore = g_allocations.load();
+            int res = nfc_emulate_target_table(device, &tag.target, tag.table,
+                                               options.emulate_transactions, &stats, 0);
+            unsigned long long allocs = g_allocations.load() - allocsBefore;
+            if (res < 0)
+                result.skipped = std::string("emulation failed: ") + nfc_strerror(device);
+            else if (stats.unmatched || stats.exchanges != stats.transactions * answered)
+                result.skipped = "the sim driver did not read the whole tag";
+            else if (stats.exchanges > 0)
+            {
+                result.iterations    = stats.exchanges;
+                result.mean_ns       = stats.latency_total_us * 1000.0 / stats.exchanges;
+                result.p50_ns        = histogramPercentile(stats, 50);
+                result.p99_ns        = histogramPercentile(stats, 99);
+                result.max_ns        = static_cast<long long>(stats.latency_max_us) * 1000;
+                result.allocs_per_op = static_cast<double>(allocs) / stats.exchanges;
+                // Lower bound of the first bucket used
+                size_t first = 0;
+                while (first + 1 < NFC_EMULATION_LATENCY_BUCKETS && !stats.latency_histogram[first])
+                    ++first;
+                result.min_ns = first ? (1LL << (first - 1)) * 1000 : 0;
+                result.histogram.assign(stats.latency_histogram,
+                                        stats.latency_histogram + NFC_EMULATION_LATENCY_BUCKETS);
+            }
+            nfc_close(device);
+        }
+        if (context)
+            nfc_exit(context);
+        nfc_emulation_table_free(tag.table);
+        std::remove(profile.c_str());
+        results.push_back(result);
+    }
+}
+
+static std::string jsonString(const std::string &value)
+{
+    std::ostringstream oss;
+    oss << '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            oss << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            oss << ' ';
+        else
+            oss << c;
+    }
+    oss << '"';
+    return oss.str();
+}
+
+static void printResults(const Options &options, const std::vector<Result> &results)
+{
+    std::ostream &out = std::cout;
+    out << "{\n"
+        << "  \"version\": " << jsonString(NFCBENCHMARK_VERSION) << ",\n"
+        << "  \"rf_exchange_us\": " << options.latency.exchange_us << ",\n"
+        << "  \"rf_byte_us\": " << options.latency.byte_us << ",\n"
+        << "  \"logging\": " << (options.log_file.empty() ? "false" : "true") << ",\n"
+        << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": " << jsonString(r.name)
+            << ", \"card\": " << jsonString(r.card);
+        if (!r.skipped.empty())
+        {
+            out << ", \"skipped\": " << jsonString(r.skipped) << "}";
+            continue;
+        }
+        out << ", \"iterations\": " << r.iterations << ", \"mean_ns\": "
+            << static_cast<long long>(r.mean_ns) << ", \"min_ns\": " << r.min_ns
+            << ", \"p50_ns\": " << r.p50_ns << ", \"p99_ns\": " << r.p99_ns
+            << ", \"allocs_per_op\": " << r.allocs_per_op;
+        if (r.bytes_per_s > 0)
+            out << ", \"bytes_per_s\": " << static_cast<long long>(r.bytes_per_s);
+        if (r.tags_per_s > 0)
+            out << ", \"tags_per_s\": " << r.tags_per_s;
+        if (r.polls_per_s > 0)
+            out << ", \"polls_per_s\": " << r.polls_per_s
+                << ", \"bus_utilisation\": " << r.bus_utilisation
+                << ", \"cpu_utilisation\": " << r.cpu_utilisation;
+        if (r.profiled)
+            out << ", \"card_ns\": " << r.card_ns << ", \"reader_ns\": " << r.reader_ns
+                << ", \"bus_ns\": " << r.bus_ns;
+        if (!r.histogram.empty())
+        {
+            out << ", \"max_ns\": " << r.max_ns << ", \"latency_histogram_us\": [";
+            for (size_t n = 0; n < r.histogram.size(); ++n)
+                out << (n ? ", " : "") << r.histogram[n];
+            out << "]";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --iterations N       commands per APDU benchmark (default 10000)\n"
+              << "  --read-iterations N  whole card reads (default 200)\n"
+              << "  --poll-iterations N  polls through the sim driver (default 50)\n"
+              << "  --inventory-tags N   tags listed by the inventory benchmark (default 40, 64 at most)\n"
+              << "  --emulate-transactions N  tag reads answered by emulation (default 200)\n"
+              << "  --idle-ms N          time waiting for no card, active then idle (default 2000)\n"
+              << "  --sim-iterations N   commands through the sim driver (default 1000)\n"
+              << "  --rf-exchange-us N   RF time of each exchange (default 0)\n"
+              << "  --rf-byte-us N       RF time per byte sent or received (default 0)\n"
+              << "  --filter TEXT        only run the benchmarks matching card/name\n"
+              << "  --log-file PATH      log to PATH while measuring the logging cost\n"
+              << "  --no-poll            do not poll through the sim driver\n"
+              << "  --no-emulate         do not emulate tags with the sim driver\n"
+              << "Exits with a failure if a selected benchmark is skipped.\n";
+}
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--no-poll")
+        {
+            options.poll = false;
+            continue;
+        }
+        if (arg == "--no-emulate")
+        {
+            options.emulate = false;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+
+        std::string value = argv[++i];
+        if (arg == "--filter")
+        {
+            options.filter = value;
+            continue;
+        }
+        if (arg == "--log-file")
+        {
+            options.log_file = value;
+            continue;
+        }
+
+        char *end;
+        unsigned long number = std::strtoul(value.c_str(), &end, 10);
+        if (*end != '\0')
+            return false;
+        if (arg == "--iterations")
+            options.iterations = static_cast<unsigned int>(number);
+        else if (arg == "--read-iterations")
+            options.read_iterations = static_cast<unsigned int>(number);
+        else if (arg == "--poll-iterations")
+            options.poll_iterations = static_cast<unsigned int>(number);
+        else if (arg == "--inventory-tags")
+            options.inventory_tags = static_cast<unsigned int>(number);
+        else if (arg == "--emulate-transactions")
+            options.emulate_transactions = static_cast<unsigned int>(number);
+        else if (arg == "--idle-ms")
+            options.idle_ms = static_cast<unsigned int>(number);
+        else if (arg == "--sim-iterations")
+            options.sim_iterations = static_cast<unsigned int>(number);
+        else if (arg == "--rf-exchange-us")
+            options.latency.exchange_us = static_cast<unsigned int>(number);
+        else if (arg == "--rf-byte-us")
+            options.latency.byte_us = static_cast<unsigned int>(number);
+        else
+            return false;
+    }
+    return true;
+}
+}
+}
+
+int main(int argc, char **argv)
+{
+    using namespace logicalaccess::benchmark;
+
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!options.log_file.empty())
+    {
+        logicalaccess::Settings::getInstance()->IsLogEnabled = true;
+        logicalaccess::Settings::getInstance()->LogFileName  = options.log_file;
+    }
+
+    std::vector<std::shared_ptr<CardModel>> cards = {
+        std::make_shared<MifareClassicModel>(), std::make_shared<MifareUltralightModel>(),
+        std::make_shared<DESFireModel>()};
+
+    std::vector<Result> results;
+    try
+    {
+        for (const std::shared_ptr<CardModel> &card : cards)
+        {
+            benchmarkApdu(options, card, results);
+            benchmarkRead(options, card, results);
+            benchmarkPoll(options, card, results);
+            benchmarkProfile(options, card, results);
+        }
+        benchmarkIdle(options, results);
+        benchmarkInventory(options, results);
+        benchmarkEmulate(options, results);
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    printResults(options, results);
+
+    // A skipped run still prints valid JSON, CI has to notice it
+    size_t skipped = 0;
+    for (const Result &result : results)
+    {
+        if (!result.skipped.empty())
+        {
+            std::cerr << "Skipped " << result.card << "/" << result.name << ": "
+                      << result.skipped << std::endl;
+            ++skipped;
+        }
+    }
+    return skipped == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
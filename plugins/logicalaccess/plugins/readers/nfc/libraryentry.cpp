@@ -5,6 +5,7 @@
 #include <logicalaccess/cards/commands.hpp>
 #include <logicalaccess/readerproviders/readerprovider.hpp>
 #include <logicalaccess/plugins/readers/nfc/nfcreaderprovider.hpp>
+#include <logicalaccess/plugins/readers/nfc/nfcsharedreaderprovider.hpp>
 #include <logicalaccess/plugins/readers/nfc/commands/mifareclassicuidchangerservice.hpp>
 #include <logicalaccess/plugins/readers/nfc/lla_readers_nfc_nfc_api.hpp>
 
@@ -22,6 +23,17 @@ LLA_READERS_NFC_NFC_API void getNFCReader(std::shared_ptr<logicalaccess::ReaderP
     }
 }
 
+#ifdef LLA_NFC_SHARED_READERS
+LLA_READERS_NFC_NFC_API void
+getNFCSharedReader(std::shared_ptr<logicalaccess::ReaderProvider> *rp)
+{
+    if (rp != nullptr)
+    {
+        *rp = logicalaccess::NFCSharedReaderProvider::createInstance();
+    }
+}
+#endif
+
 LLA_READERS_NFC_NFC_API bool getReaderInfoAt(unsigned int index, char *readername,
                                           size_t readernamelen, void **getterfct)
 {
@@ -38,6 +50,15 @@ LLA_READERS_NFC_NFC_API bool getReaderInfoAt(unsigned int index, char *readernam
             ret = true;
         }
         break;
+#ifdef LLA_NFC_SHARED_READERS
+        case 1:
+        {
+            *getterfct = (void *)&getNFCSharedReader;
+            sprintf(readername, READER_NFC_SHARED);
+            ret = true;
+        }
+        break;
+#endif
         default:;
         }
     }
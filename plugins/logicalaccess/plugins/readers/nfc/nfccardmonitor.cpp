@@ -0,0 +1,240 @@
+/**
+ * \file nfccardmonitor.cpp
+ * \brief NFC card insertion and removal monitor.
+ */
+
+#include <logicalaccess/plugins/readers/nfc/nfccardmonitor.hpp>
+#include <logicalaccess/plugins/llacommon/logs.hpp>
+#include <logicalaccess/myexception.hpp>
+
+namespace logicalaccess
+{
+/**
+ * \brief The longest time the worker waits before checking it is stopped, in
+ * milliseconds.
+ */
+#define NFC_MONITOR_WAIT 100
+
+NFCReaderMutex::NFCReaderMutex()
+    : d_subscribers(0)
+    , d_locked(false)
+{
+}
+
+void NFCReaderMutex::lock()
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+    ++d_subscribers;
+    d_released.wait(lock, [this]() { return !d_locked; });
+    d_locked = true;
+}
+
+bool NFCReaderMutex::try_lock()
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    if (d_locked)
+    {
+        return false;
+    }
+    ++d_subscribers;
+    d_locked = true;
+    return true;
+}
+
+void NFCReaderMutex::unlock()
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        --d_subscribers;
+        d_locked = false;
+    }
+    d_released.notify_all();
+}
+
+bool NFCReaderMutex::lockForPoll(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+    if (!d_released.wait_for(lock, timeout,
+                             [this]() { return !d_locked && d_subscribers == 0; }))
+    {
+        return false;
+    }
+    d_locked = true;
+    return true;
+}
+
+void NFCReaderMutex::unlockForPoll()
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_locked = false;
+    }
+    d_released.notify_all();
+}
+
+NFCCardMonitor::NFCCardMonitor(std::shared_ptr<NFCReaderUnit> readerUnit)
+    : d_readerUnit(readerUnit)
+    , d_subscribers(std::make_shared<const Subscribers>())
+    , d_next_id(1)
+    , d_running(false)
+{
+}
+
+NFCCardMonitor::~NFCCardMonitor()
+{
+    stop();
+}
+
+size_t NFCCardMonitor::subscribe(Callback callback)
+{
+    std::lock_guard<std::mutex> lock(d_subscribers_mutex);
+    std::shared_ptr<Subscribers> subscribers =
+        std::make_shared<Subscribers>(*std::atomic_load(&d_subscribers));
+    size_t id = d_next_id++;
+    subscribers->push_back(std::make_pair(id, callback));
+    std::atomic_store(&d_subscribers, std::shared_ptr<const Subscribers>(subscribers));
+    return id;
+}
+
+void NFCCardMonitor::unsubscribe(size_t id)
+{
+    std::lock_guard<std::mutex> lock(d_subscribers_mutex);
+    std::shared_ptr<Subscribers> subscribers =
+        std::make_shared<Subscribers>(*std::atomic_load(&d_subscribers));
+    for (auto it = subscribers->begin(); it != subscribers->end(); ++it)
+    {
+        if (it->first == id)
+        {
+            subscribers->erase(it);
+            break;
+        }
+    }
+    std::atomic_store(&d_subscribers, std::shared_ptr<const Subscribers>(subscribers));
+}
+
+void NFCCardMonitor::start()
+{
+    if (d_running.exchange(true))
+    {
+        return;
+    }
+    if (d_worker.joinable())
+    {
+        if (std::this_thread::get_id() == d_worker.get_id())
+        {
+            // Stopped then started again from a callback, the worker goes on
+            return;
+        }
+        d_worker.join();
+    }
+    LOG(INFOS) << "Starting the card monitor of " << d_readerUnit->getName() << ".";
+    d_worker = std::thread(&NFCCardMonitor::run, this);
+}
+
+void NFCCardMonitor::stop()
+{
+    d_running = false;
+    // A callback cannot wait for the worker it runs on
+    if (d_worker.joinable() && std::this_thread::get_id() != d_worker.get_id())
+    {
+        d_worker.join();
+    }
+}
+
+bool NFCCardMonitor::isRunning() const
+{
+    return d_running;
+}
+
+NFCReaderMutex &NFCCardMonitor::getReaderMutex()
+{
+    return d_reader_mutex;
+}
+
+void NFCCardMonitor::run()
+{
+    std::shared_ptr<Chip> chip;
+    while (d_running)
+    {
+        NFCCardEvent event;
+        event.type = NFC_CARD_ERROR;
+        bool changed = false;
+        // The removal check waits as well while a subscriber talks to the card
+        if (!d_reader_mutex.lockForPoll(std::chrono::milliseconds(NFC_MONITOR_WAIT)))
+        {
+            continue;
+        }
+        try
+        {
+            if (!chip)
+            {
+                if (d_readerUnit->waitInsertion(NFC_MONITOR_WAIT))
+                {
+                    chip       = d_readerUnit->getSingleChip();
+                    event.type = NFC_CARD_INSERTED;
+                    changed    = (chip != nullptr);
+                }
+            }
+            else if (d_readerUnit->waitRemoval(NFC_MONITOR_WAIT))
+            {
+                event.type = NFC_CARD_REMOVED;
+                changed    = true;
+            }
+        }
+        catch (std::exception &ex)
+        {
+            event.error = ex.what();
+            changed     = true;
+        }
+        catch (...)
+        {
+            event.error = "Unknown error.";
+            changed     = true;
+        }
+        event.timestamp = std::chrono::steady_clock::now();
+        d_reader_mutex.unlockForPoll();
+
+        if (!changed)
+        {
+            continue;
+        }
+
+        if (event.type != NFC_CARD_ERROR)
+        {
+            event.chip = chip;
+        }
+        if (event.type == NFC_CARD_REMOVED)
+        {
+            chip.reset();
+        }
+        publish(event);
+        if (event.type == NFC_CARD_ERROR)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(
+                d_readerUnit->getNFCConfiguration()->getPollPeriod()));
+        }
+    }
+}
+
+void NFCCardMonitor::publish(const NFCCardEvent &event)
+{
+    std::shared_ptr<const Subscribers> subscribers = std::atomic_load(&d_subscribers);
+    for (const auto &subscriber : *subscribers)
+    {
+        try
+        {
+            subscriber.second(event);
+        }
+        catch (std::exception &ex)
+        {
+            LOG(ERRORS) << "Card event subscriber " << subscriber.first
+                        << " failed: " << ex.what();
+        }
+        catch (...)
+        {
+            LOG(ERRORS) << "Card event subscriber " << subscriber.first
+                        << " failed with an unknown exception.";
+        }
+    }
+}
+}
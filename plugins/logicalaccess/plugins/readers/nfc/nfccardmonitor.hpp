@@ -0,0 +1,210 @@
+/**
+ * \file nfccardmonitor.hpp
+ * \brief NFC card insertion and removal monitor.
+ */
+
+#ifndef LOGICALACCESS_NFCCARDMONITOR_HPP
+#define LOGICALACCESS_NFCCARDMONITOR_HPP
+
+#include <logicalaccess/plugins/readers/nfc/nfcreaderunit.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logicalaccess
+{
+/**
+ * \brief The card event types.
+ */
+typedef enum {
+    NFC_CARD_INSERTED = 0x00,
+    NFC_CARD_REMOVED  = 0x01,
+    NFC_CARD_ERROR    = 0x02 /**< Polling failed, the monitor keeps on */
+} NFCCardEventType;
+
+/**
+ * \brief A card event.
+ */
+struct NFCCardEvent
+{
+    NFCCardEventType type;
+    std::chrono::steady_clock::time_point timestamp;
+    /**
+     * \brief The chip inserted or removed, null on error.
+     */
+    std::shared_ptr<Chip> chip;
+    /**
+     * \brief The error message, empty for other events.
+     */
+    std::string error;
+};
+
+/**
+ * \brief The mutex guarding a monitored reader unit device.
+ *
+ * A std::mutex is not fair: the monitor worker, locking again right after each
+ * poll, could starve a subscriber. The subscribers lock this one like a mutex
+ * and always take priority over the worker, which only polls while no
+ * subscriber holds or waits for the reader.
+ */
+class LLA_READERS_NFC_NFC_API NFCReaderMutex
+{
+  public:
+    /**
+     * \brief Constructor.
+     */
+    NFCReaderMutex();
+
+    /**
+     * \brief Lock the reader for a subscriber.
+     */
+    void lock();
+
+    /**
+     * \brief Try to lock the reader for a subscriber.
+     * \return True if locked.
+     */
+    bool try_lock();
+
+    /**
+     * \brief Unlock the reader locked by a subscriber.
+     */
+    void unlock();
+
+    /**
+     * \brief Lock the reader for a poll of the worker.
+     * \param timeout The longest time to wait for the subscribers.
+     * \return True if locked, false if subscribers still use the reader.
+     */
+    bool lockForPoll(std::chrono::milliseconds timeout);
+
+    /**
+     * \brief Unlock the reader after a poll of the worker.
+     */
+    void unlockForPoll();
+
+  private:
+    std::mutex d_mutex;
+    std::condition_variable d_released;
+
+    /**
+     * \brief The subscribers holding or waiting for the reader.
+     */
+    size_t d_subscribers;
+
+    bool d_locked;
+};
+
+/**
+ * \brief Watch a reader unit for any number of subscribers.
+ *
+ * A single worker thread waits for insertions and removals and calls every
+ * subscriber on each event, so the polling cost is paid once per reader.
+ * Callbacks run on the worker thread and must return quickly.
+ *
+ * The worker holds the reader mutex while it uses the device, at most about
+ * 100 ms at a time: subscribers lock it as well around their own card exchanges,
+ * and the worker does not poll again until they are done. The removal check
+ * reconnects the card, so card state such as an authentication does not survive
+ * releasing the mutex.
+ */
+class LLA_READERS_NFC_NFC_API NFCCardMonitor
+{
+  public:
+    typedef std::function<void(const NFCCardEvent &)> Callback;
+
+    /**
+     * \brief Constructor.
+     * \param readerUnit The reader unit to watch, already connected to its device.
+     */
+    explicit NFCCardMonitor(std::shared_ptr<NFCReaderUnit> readerUnit);
+
+    /**
+     * \brief Destructor, stops the monitor.
+     */
+    ~NFCCardMonitor();
+
+    /**
+     * \brief Add a subscriber.
+     * \param callback The function called on each event.
+     * \return The subscription id.
+     */
+    size_t subscribe(Callback callback);
+
+    /**
+     * \brief Remove a subscriber.
+     * \param id The subscription id.
+     *
+     * The callback may still be running on the worker when this returns.
+     */
+    void unsubscribe(size_t id);
+
+    /**
+     * \brief Start the worker thread.
+     */
+    void start();
+
+    /**
+     * \brief Stop the worker thread and wait for it.
+     *
+     * From a callback, the worker only stops after the callbacks of the event.
+     */
+    void stop();
+
+    /**
+     * \brief Get if the worker thread runs.
+     * \return True if started.
+     */
+    bool isRunning() const;
+
+    /**
+     * \brief Get the mutex guarding the reader unit device.
+     * \return The reader mutex.
+     */
+    NFCReaderMutex &getReaderMutex();
+
+  protected:
+    typedef std::vector<std::pair<size_t, Callback>> Subscribers;
+
+    /**
+     * \brief The worker thread loop.
+     */
+    void run();
+
+    /**
+     * \brief Call the subscribers.
+     * \param event The event.
+     */
+    void publish(const NFCCardEvent &event);
+
+    std::shared_ptr<NFCReaderUnit> d_readerUnit;
+
+    NFCReaderMutex d_reader_mutex;
+
+    /**
+     * \brief The subscribers, replaced as a whole on change so that publishing
+     * needs no lock.
+     */
+    std::shared_ptr<const Subscribers> d_subscribers;
+
+    /**
+     * \brief Guards the subscribers changes.
+     */
+    std::mutex d_subscribers_mutex;
+
+    size_t d_next_id;
+
+    std::atomic<bool> d_running;
+
+    std::thread d_worker;
+};
+}
+
+#endif /* LOGICALACCESS_NFCCARDMONITOR_HPP */
@@ -0,0 +1,84 @@
+/**
+ * \file nfcchipfactory.cpp
+ * \brief NFC chip factory.
+ */
+
+#include <logicalaccess/plugins/readers/nfc/nfcchipfactory.hpp>
+#include <logicalaccess/plugins/readers/nfc/commands/mifarenfccommands.hpp>
+#include <logicalaccess/plugins/readers/iso7816/commands/desfireev1iso7816commands.hpp>
+#include <logicalaccess/plugins/readers/iso7816/commands/desfireiso7816resultchecker.hpp>
+#include <logicalaccess/plugins/readers/iso7816/iso7816resultchecker.hpp>
+
+namespace logicalaccess
+{
+NFCChipFactory::NFCChipFactory()
+    : d_iso7816_checker(std::make_shared<ISO7816ResultChecker>())
+    , d_desfire_checker(std::make_shared<DESFireISO7816ResultChecker>())
+{
+}
+
+NFCCardTypeId NFCChipFactory::getTypeId(const std::string &type)
+{
+    auto it = d_ids.find(type);
+    if (it != d_ids.end())
+    {
+        return it->second;
+    }
+
+    CardType cardType;
+    cardType.type          = type;
+    cardType.commands      = NFC_COMMANDS_NONE;
+    cardType.resultChecker = d_iso7816_checker; // default one
+    cardType.unsupported   = false;
+    if (type == "Mifare1K" || type == "Mifare4K" || type == "Mifare")
+    {
+        cardType.commands = NFC_COMMANDS_MIFARE;
+    }
+    else if (type == "DESFireEV1")
+    {
+        cardType.commands      = NFC_COMMANDS_DESFIRE_EV1;
+        cardType.resultChecker = d_desfire_checker;
+    }
+    else if (type == "DESFire")
+    {
+        cardType.commands      = NFC_COMMANDS_DESFIRE;
+        cardType.resultChecker = d_desfire_checker;
+    }
+
+    NFCCardTypeId id = static_cast<NFCCardTypeId>(d_types.size());
+    d_types.push_back(cardType);
+    d_ids[type] = id;
+    return id;
+}
+
+const std::string &NFCChipFactory::getType(NFCCardTypeId id) const
+{
+    return d_types.at(id).type;
+}
+
+bool NFCChipFactory::isUnsupported(NFCCardTypeId id) const
+{
+    return d_types.at(id).unsupported;
+}
+
+void NFCChipFactory::setUnsupported(NFCCardTypeId id)
+{
+    d_types.at(id).unsupported = true;
+}
+
+std::shared_ptr<Commands> NFCChipFactory::createCommands(NFCCardTypeId id) const
+{
+    switch (d_types.at(id).commands)
+    {
+    case NFC_COMMANDS_MIFARE: return std::make_shared<MifareNFCCommands>();
+    case NFC_COMMANDS_DESFIRE: return std::make_shared<DESFireISO7816Commands>();
+    case NFC_COMMANDS_DESFIRE_EV1: return std::make_shared<DESFireEV1ISO7816Commands>();
+    default: return nullptr;
+    }
+}
+
+std::shared_ptr<ResultChecker> NFCChipFactory::getResultChecker(NFCCardTypeId id) const
+{
+    return d_types.at(id).resultChecker;
+}
+}
@@ -0,0 +1,122 @@
+/**
+ * \file nfcchipfactory.hpp
+ * \brief NFC chip factory.
+ */
+
+#ifndef LOGICALACCESS_NFCCHIPFACTORY_HPP
+#define LOGICALACCESS_NFCCHIPFACTORY_HPP
+
+#include <logicalaccess/plugins/readers/nfc/lla_readers_nfc_nfc_api.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace logicalaccess
+{
+class Commands;
+class ResultChecker;
+
+/**
+ * \brief A card type, interned by a NFCChipFactory.
+ */
+typedef unsigned int NFCCardTypeId;
+
+/**
+ * \brief Resolves once per card type what the chips of a reader unit are made of.
+ *
+ * The commands implementation and the result checker of a card type are looked up
+ * on its first use only. Result checkers hold no state, a single one is shared by
+ * all the chips of a type.
+ */
+class LLA_READERS_NFC_NFC_API NFCChipFactory
+{
+  public:
+    /**
+     * \brief Constructor.
+     */
+    NFCChipFactory();
+
+    /**
+     * \brief Get the id of a card type, resolving it on first use.
+     * \param type The card type.
+     * \return The card type id.
+     */
+    NFCCardTypeId getTypeId(const std::string &type);
+
+    /**
+     * \brief Get the name of a card type.
+     * \param id The card type id.
+     * \return The card type.
+     */
+    const std::string &getType(NFCCardTypeId id) const;
+
+    /**
+     * \brief Get if no card plugin provides chips of a card type.
+     * \param id The card type id.
+     * \return True if the card type is known to have no chip.
+     */
+    bool isUnsupported(NFCCardTypeId id) const;
+
+    /**
+     * \brief Remember no card plugin provides chips of a card type.
+     * \param id The card type id.
+     */
+    void setUnsupported(NFCCardTypeId id);
+
+    /**
+     * \brief Create the commands of a card type chip.
+     * \param id The card type id.
+     * \return The commands, null if the reader has no specific commands for it.
+     */
+    std::shared_ptr<Commands> createCommands(NFCCardTypeId id) const;
+
+    /**
+     * \brief Get the result checker shared by the chips of a card type.
+     * \param id The card type id.
+     * \return The result checker.
+     */
+    std::shared_ptr<ResultChecker> getResultChecker(NFCCardTypeId id) const;
+
+  protected:
+    /**
+     * \brief The commands implementations the reader provides.
+     */
+    typedef enum {
+        NFC_COMMANDS_NONE = 0x00,
+        NFC_COMMANDS_MIFARE,
+        NFC_COMMANDS_DESFIRE,
+        NFC_COMMANDS_DESFIRE_EV1
+    } NFCCommandsType;
+
+    /**
+     * \brief What a card type resolves to.
+     */
+    struct CardType
+    {
+        std::string type;
+        NFCCommandsType commands;
+        std::shared_ptr<ResultChecker> resultChecker;
+        bool unsupported;
+    };
+
+    /**
+     * \brief The card types, by id.
+     */
+    std::vector<CardType> d_types;
+
+    /**
+     * \brief The card type ids, by name.
+     */
+    std::map<std::string, NFCCardTypeId> d_ids;
+
+    /**
+     * \brief The shared result checkers.
+     */
+    std::shared_ptr<ResultChecker> d_iso7816_checker;
+    std::shared_ptr<ResultChecker> d_desfire_checker;
+};
+}
+
+#endif /* LOGICALACCESS_NFCCHIPFACTORY_HPP */
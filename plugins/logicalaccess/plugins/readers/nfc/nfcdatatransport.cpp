@@ -17,12 +17,14 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <ctime>
+#include <chrono>
 
 namespace logicalaccess
 {
 NFCDataTransport::NFCDataTransport()
     : DataTransport()
     , d_isConnected(false)
+    , d_timeout(2000)
     , ignore_error_(false)
 {
 }
@@ -53,6 +55,29 @@ std::string NFCDataTransport::getName() const
 }
 
 void NFCDataTransport::send(const std::vector<unsigned char> &data)
+{
+    if (data.size() > 0)
+    {
+        LOG(LogLevel::COMS) << "APDU command: " << BufferHelper::getHex(data);
+    }
+    long int timeout = d_timeout;
+    int res          = transceive(data, timeout);
+    if (res >= 0)
+    {
+        LOG(DEBUGS) << "Received " << res << " bytes from the NFC reader.";
+    }
+    else if (res == NFC_ETIMEOUT)
+    {
+        LOG(DEBUGS) << "No response within " << timeout << " ms.";
+    }
+    if (res < 0 && !ignore_error_)
+    {
+        CheckNFCError(res);
+    }
+}
+
+int NFCDataTransport::transceive(const std::vector<unsigned char> &data,
+                                 long int &timeout)
 {
     d_response.clear();
 
@@ -60,72 +85,80 @@ void NFCDataTransport::send(const std::vector<unsigned char> &data)
                               "The NFC reader unit object "
                               "is null. We cannot send.");
 
+    // The prefetch may still be talking to the card
+    getNFCReaderUnit()->waitPrefetch();
+    if (!d_prefetched.empty() && data.size() > 0)
+    {
+        if (d_prefetched.front().first == data)
+        {
+            LOG(LogLevel::COMS) << "Prefetched response used.";
+            d_response = d_prefetched.front().second;
+            d_prefetched.pop_front();
+            return static_cast<int>(d_response.size());
+        }
+        // The card went on with the script: whatever the application does now
+        // goes to the card.
+        LOG(DEBUGS) << "Dropping " << d_prefetched.size() << " prefetched responses.";
+        d_prefetched.clear();
+    }
+
     if (data.size() > 0)
     {
         unsigned char returnedData[255];
         memset(returnedData, 0x00, sizeof(returnedData));
-        LOG(LogLevel::COMS) << "APDU command: " << BufferHelper::getHex(data);
 
+        std::shared_ptr<Chip> chip = getChip();
+        if (chip)
+        {
+            // Address the logical target of our chip, the other activated card
+            // stays selected.
+            getNFCReaderUnit()->selectChip(chip);
+        }
+
+        timeout = getNFCReaderUnit()->getCommandTimeout(chip, d_timeout);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
         int res = nfc_initiator_transceive_bytes(getNFCReaderUnit()->getDevice(),
                                                  &data[0], data.size(), returnedData,
-                                                 sizeof(returnedData), 0);
+                                                 sizeof(returnedData), timeout);
+        std::chrono::microseconds elapsed =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+        if (res >= 0 || res == NFC_ERFTRANS)
+        {
+            // An RF error may be a card answering too late: it is sampled too
+            getNFCReaderUnit()->profileResponseTime(chip, elapsed);
+        }
+        if (res >= 0)
+        {
+            getNFCReaderUnit()->recordCommandLatency(elapsed);
+        }
+        else if (res == NFC_ETIMEOUT)
+        {
+            getNFCReaderUnit()->recordCommandTimeout();
+        }
         if (res == NFC_EMFCAUTHFAIL)
         {
             // If the authentication command fail against a Mifare Classic,
-            // the card is unusable unless we re-select it again. Calling
-            // connect() on the reader unit does the job.
-            getReaderUnit()->connect();
+            // the card is unusable unless we re-select it again.
+            if (chip)
+                getNFCReaderUnit()->reselectChip(chip);
+            else
+                getReaderUnit()->connect();
         }
         if (res >= 0)
         {
-            LOG(DEBUGS) << "Received " << res << " bytes from the NFC reader.";
             d_response = std::vector<unsigned char>(returnedData, returnedData + res);
         }
-        else if (!ignore_error_)
-        {
-            CheckNFCError(res);
-        }
+        return res;
     }
+    return NFC_SUCCESS;
 }
 
 void NFCDataTransport::CheckNFCError(int errorFlag)
 {
     if (errorFlag < 0)
     {
-        char conv[64];
-        std::string msg = std::string("NFC error : ");
-        sprintf(conv, "%d", errorFlag);
-        msg += std::string(conv);
-        msg += std::string(". ");
-
-        switch (errorFlag)
-        {
-        case NFC_EIO:
-            msg += std::string("Input / output error, device may not be usable anymore "
-                               "without re-open it.");
-            break;
-        case NFC_EINVARG: msg += std::string("Invalid argument(s)."); break;
-        case NFC_EDEVNOTSUPP:
-            msg += std::string("Operation not supported by device.");
-            break;
-        case NFC_ENOTSUCHDEV: msg += std::string("No such device."); break;
-        case NFC_EOVFLOW: msg += std::string("Buffer overflow."); break;
-        case NFC_ETIMEOUT: msg += std::string("Operation timed out."); break;
-        case NFC_EOPABORTED: msg += std::string("Operation aborted (by user)."); break;
-        case NFC_ENOTIMPL: msg += std::string("Not (yet) implemented."); break;
-        case NFC_ETGRELEASED: msg += std::string("Target released."); break;
-        case NFC_ERFTRANS: msg += std::string("Error while RF transmission."); break;
-        case NFC_EMFCAUTHFAIL:
-            msg += std::string("MIFARE Classic: authentication failed.");
-            break;
-        case NFC_ESOFT:
-            msg += std::string("Software error (allocation, file/pipe creation, etc.).");
-            break;
-        case NFC_ECHIP: msg += std::string("Device's internal chip error."); break;
-        default:;
-        }
-
-        THROW_EXCEPTION_WITH_LOG(CardException, msg);
+        throwNFCError(errorFlag);
     }
 }
 
@@ -164,6 +197,7 @@ NFCDataTransport::sendCommand(const std::vector<unsigned char> &command, long in
 
     d_lastCommand = command;
     d_lastResult.clear();
+    d_timeout = timeout;
 
     if (command.size() > 0)
         send(command);
@@ -176,6 +210,125 @@ NFCDataTransport::sendCommand(const std::vector<unsigned char> &command, long in
     return res;
 }
 
+NFCBatchResult NFCDataTransport::sendCommands(const std::vector<NFCBatchStep> &steps,
+                                              long int timeout)
+{
+    // A PN53x frame holds at most 264 bytes
+    const size_t maxResponse = 264;
+    NFCBatchResult result;
+    result.succeeded = 0;
+    result.error     = 0;
+    result.data.reserve(steps.size() * maxResponse);
+    result.ends.reserve(steps.size());
+
+    EXCEPTION_ASSERT_WITH_LOG(getNFCReaderUnit(), LibLogicalAccessException,
+                              "The NFC reader unit object "
+                              "is null. We cannot send.");
+    std::shared_ptr<NFCReaderUnit> readerUnit = getNFCReaderUnit();
+    readerUnit->waitPrefetch();
+    d_prefetched.clear();
+
+    std::shared_ptr<Chip> chip = getChip();
+    if (chip)
+    {
+        readerUnit->selectChip(chip);
+    }
+    nfc_device *device = readerUnit->getDevice();
+    long int stepTimeout = readerUnit->getCommandTimeout(chip, timeout);
+
+    LOG(LogLevel::COMS) << "Sending a batch of " << steps.size() << " commands...";
+    std::chrono::steady_clock::time_point batchStart = std::chrono::steady_clock::now();
+    for (const NFCBatchStep &step : steps)
+    {
+        size_t offset = result.data.size();
+        result.data.resize(offset + maxResponse);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int res = nfc_initiator_transceive_bytes(device, step.command.data(),
+                                                 step.command.size(), &result.data[offset],
+                                                 maxResponse, stepTimeout);
+        std::chrono::microseconds elapsed =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+        if (res >= 0 || res == NFC_ERFTRANS)
+        {
+            readerUnit->profileResponseTime(chip, elapsed);
+        }
+        if (res < 0)
+        {
+            result.data.resize(offset);
+            result.error = res;
+            if (res == NFC_ETIMEOUT)
+            {
+                readerUnit->recordCommandTimeout();
+            }
+            else if (res == NFC_EMFCAUTHFAIL)
+            {
+                // The card is unusable unless we re-select it again.
+                if (chip)
+                    readerUnit->reselectChip(chip);
+                else
+                    readerUnit->connect();
+            }
+            break;
+        }
+        readerUnit->recordCommandLatency(elapsed);
+        result.data.resize(offset + res);
+        result.ends.push_back(result.data.size());
+
+        if (step.accepts(result.data.data() + offset, res))
+        {
+            ++result.succeeded;
+        }
+        else if (step.onUnexpectedStatus == NFC_BATCH_STOP)
+        {
+            break;
+        }
+    }
+
+    LOG(LogLevel::COMS) << "Batch done: " << result.ends.size() << "/" << steps.size()
+                        << " commands sent, " << result.succeeded << " succeeded in "
+                        << std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - batchStart)
+                               .count()
+                        << " us (error " << result.error << ").";
+    return result;
+}
+
+NFCResult<std::vector<unsigned char>>
+NFCDataTransport::trySendCommand(const std::vector<unsigned char> &command,
+                                 long int timeout) noexcept
+{
+    try
+    {
+        d_lastCommand = command;
+        d_lastResult.clear();
+        d_timeout = timeout;
+
+        int res = transceive(command, timeout);
+        if (res < 0)
+        {
+            return NFCResult<std::vector<unsigned char>>::failure(res);
+        }
+        d_lastResult = d_response;
+        d_response.clear();
+        return d_lastResult;
+    }
+    catch (...)
+    {
+        return NFCResult<std::vector<unsigned char>>::failure(std::current_exception());
+    }
+}
+
+void NFCDataTransport::setPrefetchedResponses(const NFCPrefetchedResponses &responses)
+{
+    d_prefetched = responses;
+}
+
+void NFCDataTransport::clearPrefetchedResponses()
+{
+    d_prefetched.clear();
+}
+
 bool NFCDataTransport::ignoreAllError(bool ignore)
 {
     bool tmp      = ignore_error_;
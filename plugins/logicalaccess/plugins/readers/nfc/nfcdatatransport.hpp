@@ -9,12 +9,92 @@
 
 #include <logicalaccess/readerproviders/datatransport.hpp>
 #include <logicalaccess/plugins/readers/nfc/nfcreaderunit.hpp>
+#include <logicalaccess/plugins/readers/nfc/nfcresult.hpp>
 #include <list>
 
 namespace logicalaccess
 {
 #define TRANSPORT_NFC "NFC"
 
+/**
+ * \brief What a batch does after a step answered an unexpected status.
+ */
+typedef enum {
+    NFC_BATCH_STOP     = 0x00, /**< The next steps are not sent */
+    NFC_BATCH_CONTINUE = 0x01  /**< The next step is sent anyway */
+} NFCBatchPolicy;
+
+/**
+ * \brief A command of a batch.
+ */
+struct NFCBatchStep
+{
+    std::vector<unsigned char> command;
+    /**
+     * \brief The expected status word (SW1 SW2), compared under statusMask.
+     */
+    unsigned short expectedStatus;
+    /**
+     * \brief The status word bits to compare, 0 to accept any response.
+     */
+    unsigned short statusMask;
+    NFCBatchPolicy onUnexpectedStatus;
+
+    /**
+     * \brief Check a response has the expected status.
+     * \param response The response.
+     * \param length The response length.
+     * \return True if the response is accepted.
+     */
+    bool accepts(const unsigned char *response, size_t length) const
+    {
+        if (statusMask == 0)
+            return true;
+        if (length < 2)
+            return false;
+        unsigned short status =
+            static_cast<unsigned short>((response[length - 2] << 8) | response[length - 1]);
+        return (status & statusMask) == (expectedStatus & statusMask);
+    }
+};
+
+/**
+ * \brief The responses of a batch.
+ */
+struct NFCBatchResult
+{
+    /**
+     * \brief The responses, back to back.
+     */
+    std::vector<unsigned char> data;
+
+    /**
+     * \brief The end of each response in data, one per step sent.
+     */
+    std::vector<size_t> ends;
+
+    /**
+     * \brief The number of steps answered with their expected status.
+     */
+    size_t succeeded;
+
+    /**
+     * \brief The libnfc error of the step the batch stopped on, 0 if none.
+     */
+    int error;
+
+    /**
+     * \brief Get the response of a step.
+     * \param step The step index, lower than ends.size().
+     * \return The step response.
+     */
+    std::vector<unsigned char> getResponse(size_t step) const
+    {
+        size_t begin = (step == 0) ? 0 : ends[step - 1];
+        return std::vector<unsigned char>(data.begin() + begin, data.begin() + ends[step]);
+    }
+};
+
 /**
  * \brief An NFC data transport class.
  */
@@ -93,12 +173,15 @@ class LLA_READERS_NFC_NFC_API NFCDataTransport : public DataTransport
     /**
      * \brief Send the data using rpleth protocol computation.
      * \param data The data to send.
+     *
+     * The exchange is bounded by the adaptive timeout of the reader unit, within
+     * the timeout of the last sendCommand().
      */
     void send(const std::vector<unsigned char> &data) override;
 
     /**
      * \brief Receive data from reader.
-     * \param timeout The time to wait data.
+     * \param timeout Unused, the response was already read by send().
      * \return The data from reader.
      */
     std::vector<unsigned char> receive(long int timeout = 5000) override;
@@ -112,6 +195,31 @@ class LLA_READERS_NFC_NFC_API NFCDataTransport : public DataTransport
     std::vector<unsigned char> sendCommand(const std::vector<unsigned char> &command,
                                            long int timeout = 2000) override;
 
+    /**
+     * \brief Send a command to the reader, without throwing.
+     * \param command The command buffer.
+     * \param timeout The command timeout.
+     * \return The response, or the libnfc error.
+     *
+     * Meant for loops where timeouts and RF errors are routine: nothing is logged
+     * or formatted on failure, the ignore error flag is not involved.
+     */
+    NFCResult<std::vector<unsigned char>>
+    trySendCommand(const std::vector<unsigned char> &command,
+                   long int timeout = 2000) noexcept;
+
+    /**
+     * \brief Send commands back to back.
+     * \param steps The commands, with their expected status.
+     * \param timeout The timeout of each command.
+     * \return The responses.
+     *
+     * The commands skip the per command logging and result checker: only the
+     * step rules decide to go on. A libnfc error always stops the batch.
+     */
+    NFCBatchResult sendCommands(const std::vector<NFCBatchStep> &steps,
+                                long int timeout = 2000);
+
     /**
     * \brief Check the NFC error and throw exception if needed.
     * \param errorFlag The error flag.
@@ -132,11 +240,66 @@ class LLA_READERS_NFC_NFC_API NFCDataTransport : public DataTransport
      */
     bool ignoreAllError() const;
 
+    /**
+     * \brief Set the chip commands are routed to.
+     * \param chip The chip, or null to address the current target.
+     */
+    void setChip(std::weak_ptr<Chip> chip)
+    {
+        d_chip = chip;
+    }
+
+    /**
+     * \brief Get the chip commands are routed to.
+     * \return The chip, or null if commands go to the current target.
+     */
+    std::shared_ptr<Chip> getChip() const
+    {
+        return d_chip.lock();
+    }
+
+    /**
+     * \brief Set the responses to the commands the reader unit sent ahead.
+     * \param responses The commands and their response, in the order they were sent.
+     *
+     * Commands matching them in order are answered without any RF exchange. The
+     * first other command drops the remaining ones.
+     */
+    void setPrefetchedResponses(const NFCPrefetchedResponses &responses);
+
+    /**
+     * \brief Drop the prefetched responses not used yet.
+     */
+    void clearPrefetchedResponses();
+
   protected:
+    /**
+     * \brief Exchange data with the chip, keeping the response for receive().
+     * \param data The data to send.
+     * \param timeout Set to the timeout applied to the exchange, in milliseconds.
+     * \return The response length, or the libnfc error.
+     */
+    int transceive(const std::vector<unsigned char> &data, long int &timeout);
+
     bool d_isConnected;
 
+    /**
+     * \brief The chip this transport talks to, when several are activated.
+     */
+    std::weak_ptr<Chip> d_chip;
+
     std::vector<unsigned char> d_response;
 
+    /**
+     * \brief The timeout of the command being sent, in milliseconds.
+     */
+    long int d_timeout;
+
+    /**
+     * \brief The prefetched responses not used yet.
+     */
+    NFCPrefetchedResponses d_prefetched;
+
     bool ignore_error_;
 };
 }
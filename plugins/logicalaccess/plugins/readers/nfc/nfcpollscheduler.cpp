@@ -0,0 +1,139 @@
+/**
+ * \file nfcpollscheduler.cpp
+ * \brief NFC adaptive poll scheduler.
+ */
+
+#include <logicalaccess/plugins/readers/nfc/nfcpollscheduler.hpp>
+
+#include <algorithm>
+
+namespace logicalaccess
+{
+/**
+ * \brief The share of detections under which a modulation is rare.
+ */
+#define NFC_POLL_RARE_SHARE 0.05
+
+/**
+ * \brief The weight of the last sample in the smoothed shares and costs, as a
+ * shift: 1/16 for the shares, 1/8 for the costs.
+ */
+#define NFC_POLL_SHARE_SHIFT 4
+#define NFC_POLL_COST_SHIFT 3
+
+NFCPollScheduler::NFCPollScheduler()
+{
+}
+
+void NFCPollScheduler::setModulations(const std::vector<nfc_modulation> &modulations)
+{
+    bool same = modulations.size() == d_statistics.size();
+    for (size_t i = 0; same && i < modulations.size(); ++i)
+    {
+        same = modulations[i].nmt == d_statistics[i].modulation.nmt &&
+               modulations[i].nbr == d_statistics[i].modulation.nbr;
+    }
+    if (same)
+    {
+        return;
+    }
+
+    d_statistics.clear();
+    for (const nfc_modulation &modulation : modulations)
+    {
+        NFCPollStatistics statistics = NFCPollStatistics();
+        statistics.modulation        = modulation;
+        d_statistics.push_back(statistics);
+    }
+    reset();
+}
+
+std::vector<size_t> NFCPollScheduler::schedule(unsigned int probeInterval)
+{
+    std::vector<size_t> order;
+    for (size_t i = 0; i < d_statistics.size(); ++i)
+    {
+        NFCPollStatistics &statistics = d_statistics[i];
+        if (probeInterval == 0 || statistics.share >= NFC_POLL_RARE_SHARE ||
+            statistics.skipped + 1 >= probeInterval)
+        {
+            order.push_back(i);
+        }
+        else
+        {
+            ++statistics.skipped;
+        }
+    }
+    // With many candidates they may all be rare, the most frequent one is kept
+    if (order.empty() && !d_statistics.empty())
+    {
+        auto it = std::max_element(
+            d_statistics.begin(), d_statistics.end(),
+            [](const NFCPollStatistics &a, const NFCPollStatistics &b) {
+                return a.share < b.share;
+            });
+        order.push_back(static_cast<size_t>(it - d_statistics.begin()));
+    }
+
+    // Decreasing detections per microsecond. A modulation not polled yet is given
+    // the mean cost of the others, so the first cycle keeps the configured order.
+    long long total = 0, measured = 0;
+    for (const NFCPollStatistics &statistics : d_statistics)
+    {
+        if (statistics.polls > 0)
+        {
+            total += std::max<long long>(statistics.cost.count(), 1);
+            ++measured;
+        }
+    }
+    std::vector<double> rates(d_statistics.size());
+    for (size_t i = 0; i < d_statistics.size(); ++i)
+    {
+        long long cost = d_statistics[i].polls > 0
+                             ? std::max<long long>(d_statistics[i].cost.count(), 1)
+                             : (measured > 0 ? total / measured : 1);
+        rates[i] = d_statistics[i].share / cost;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&rates](size_t a, size_t b) { return rates[a] > rates[b]; });
+    return order;
+}
+
+void NFCPollScheduler::record(size_t index, std::chrono::microseconds duration,
+                              bool detected)
+{
+    NFCPollStatistics &statistics = d_statistics.at(index);
+    statistics.skipped            = 0;
+    if (statistics.polls++ == 0)
+    {
+        statistics.cost = duration;
+    }
+    else
+    {
+        statistics.cost += (duration - statistics.cost) / (1 << NFC_POLL_COST_SHIFT);
+    }
+
+    if (detected)
+    {
+        ++statistics.detections;
+        for (size_t i = 0; i < d_statistics.size(); ++i)
+        {
+            d_statistics[i].share +=
+                ((i == index ? 1.0 : 0.0) - d_statistics[i].share) /
+                (1 << NFC_POLL_SHARE_SHIFT);
+        }
+    }
+}
+
+void NFCPollScheduler::reset()
+{
+    for (NFCPollStatistics &statistics : d_statistics)
+    {
+        statistics.share      = 1.0 / d_statistics.size();
+        statistics.cost       = std::chrono::microseconds(0);
+        statistics.polls      = 0;
+        statistics.detections = 0;
+        statistics.skipped    = 0;
+    }
+}
+}
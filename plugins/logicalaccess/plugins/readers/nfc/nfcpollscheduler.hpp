@@ -0,0 +1,97 @@
+/**
+ * \file nfcpollscheduler.hpp
+ * \brief NFC adaptive poll scheduler.
+ */
+
+#ifndef LOGICALACCESS_NFCPOLLSCHEDULER_HPP
+#define LOGICALACCESS_NFCPOLLSCHEDULER_HPP
+
+#include <logicalaccess/plugins/readers/nfc/lla_readers_nfc_nfc_api.hpp>
+#include <nfc/nfc-types.h>
+
+#include <chrono>
+#include <vector>
+
+namespace logicalaccess
+{
+/**
+ * \brief What a reader unit observed of a poll modulation.
+ */
+struct NFCPollStatistics
+{
+    nfc_modulation modulation;
+    /**
+     * \brief The share of the recent detections made with this modulation.
+     */
+    double share;
+    /**
+     * \brief The smoothed duration of a poll with this modulation.
+     */
+    std::chrono::microseconds cost;
+    size_t polls;
+    size_t detections;
+    /**
+     * \brief The poll cycles skipped since this modulation was last polled.
+     */
+    unsigned int skipped;
+};
+
+/**
+ * \brief Orders the poll modulations of a reader unit by the cards it sees.
+ *
+ * Each cycle polls the modulations by decreasing share of detections per time
+ * spent polling, which minimizes the expected time to detect a card. Rare
+ * modulations, under 5% of the recent detections, are only polled once every
+ * probe interval cycles so that they are never starved. All modulations start
+ * with an equal share, in the configured order.
+ */
+class LLA_READERS_NFC_NFC_API NFCPollScheduler
+{
+  public:
+    /**
+     * \brief Constructor.
+     */
+    NFCPollScheduler();
+
+    /**
+     * \brief Set the candidate modulations, resetting the statistics if they change.
+     * \param modulations The modulations, in configured order.
+     */
+    void setModulations(const std::vector<nfc_modulation> &modulations);
+
+    /**
+     * \brief Choose the modulations of the next poll cycle.
+     * \param probeInterval The cycles between two polls of a rare modulation. 0
+     * never skips any.
+     * \return The indexes of the modulations to poll, in order.
+     */
+    std::vector<size_t> schedule(unsigned int probeInterval);
+
+    /**
+     * \brief Account a poll.
+     * \param index The modulation index.
+     * \param duration The poll duration.
+     * \param detected True if the poll found a card.
+     */
+    void record(size_t index, std::chrono::microseconds duration, bool detected);
+
+    /**
+     * \brief Forget what was observed.
+     */
+    void reset();
+
+    /**
+     * \brief Get the statistics of the candidate modulations.
+     * \return The statistics, in configured order.
+     */
+    const std::vector<NFCPollStatistics> &getStatistics() const
+    {
+        return d_statistics;
+    }
+
+  protected:
+    std::vector<NFCPollStatistics> d_statistics;
+};
+}
+
+#endif /* LOGICALACCESS_NFCPOLLSCHEDULER_HPP */
@@ -0,0 +1,121 @@
+/**
+ * \file nfcreaderdaemon.cpp
+ * \brief NFC reader sharing daemon.
+ */
+
+#include <logicalaccess/plugins/readers/nfc/nfcreaderdaemon.hpp>
+#include <logicalaccess/plugins/llacommon/logs.hpp>
+#include <logicalaccess/myexception.hpp>
+
+namespace logicalaccess
+{
+#ifdef LLA_NFC_SHARED_READERS
+NFCReaderDaemon::NFCReaderDaemon(std::shared_ptr<NFCReaderProvider> provider,
+                                 const std::string &socketPath)
+    : d_provider(provider)
+    , d_socket_path(socketPath)
+    , d_server(nullptr)
+    , d_running(false)
+{
+}
+
+NFCReaderDaemon::~NFCReaderDaemon()
+{
+    stop();
+}
+
+void NFCReaderDaemon::start()
+{
+    if (d_running)
+    {
+        return;
+    }
+
+    d_server = nfc_shared_server_new(d_socket_path.c_str());
+    if (d_server == nullptr)
+        THROW_EXCEPTION_WITH_LOG(LibLogicalAccessException,
+                                 "Unable to listen on " + d_socket_path +
+                                     ", is another daemon running?");
+
+    d_provider->refreshReaderList();
+    for (auto ru : d_provider->getReaderList())
+    {
+        const std::string connstring = ru->getName();
+        // Shared readers come from another daemon
+        if (connstring.empty() || connstring.compare(0, 7, "shared:") == 0)
+            continue;
+
+        nfc_device *device = nfc_open(d_provider->getContext(), connstring.c_str());
+        if (device == nullptr)
+        {
+            LOG(WARNINGS) << "Unable to open " << connstring << ", it is not shared.";
+            continue;
+        }
+        if (nfc_shared_server_add_device(d_server, device) < 0)
+        {
+            LOG(WARNINGS) << "Unable to share " << connstring << ".";
+            nfc_close(device);
+            continue;
+        }
+        LOG(INFOS) << "Sharing " << connstring << " on " << d_socket_path << ".";
+        d_devices.push_back(device);
+    }
+    if (d_devices.empty())
+    {
+        release();
+        THROW_EXCEPTION_WITH_LOG(LibLogicalAccessException, "No reader to share.");
+    }
+
+    d_running = true;
+    d_worker  = std::thread([this]() {
+        if (nfc_shared_server_run(d_server) < 0)
+        {
+            LOG(ERRORS) << "The reader sharing daemon stopped on an error.";
+        }
+    });
+}
+
+void NFCReaderDaemon::stop()
+{
+    if (!d_running.exchange(false))
+    {
+        return;
+    }
+    nfc_shared_server_stop(d_server);
+    if (d_worker.joinable())
+    {
+        d_worker.join();
+    }
+    release();
+}
+
+bool NFCReaderDaemon::isRunning() const
+{
+    return d_running;
+}
+
+std::vector<std::string> NFCReaderDaemon::getSharedReaders() const
+{
+    std::vector<std::string> readers;
+    for (auto device : d_devices)
+    {
+        readers.push_back(nfc_device_get_connstring(device));
+    }
+    return readers;
+}
+
+void NFCReaderDaemon::release()
+{
+    if (d_server != nullptr)
+    {
+        nfc_shared_server_free(d_server);
+        d_server = nullptr;
+    }
+    for (auto device : d_devices)
+    {
+        nfc_close(device);
+    }
+    d_devices.clear();
+}
+#endif
+}
@@ -0,0 +1,108 @@
+/**
+ * \file nfcreaderdaemon.hpp
+ * \brief NFC reader sharing daemon.
+ */
+
+#ifndef LOGICALACCESS_NFCREADERDAEMON_HPP
+#define LOGICALACCESS_NFCREADERDAEMON_HPP
+
+#include <logicalaccess/plugins/readers/nfc/nfcreaderprovider.hpp>
+
+#ifdef LLA_NFC_SHARED_READERS
+#include <nfc/nfc-shared.h>
+#endif
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logicalaccess
+{
+#ifdef LLA_NFC_SHARED_READERS
+/**
+ * \brief Share the readers of a provider with the other processes of the host.
+ *
+ * The daemon opens every local reader of the provider and serves them on a
+ * Unix socket from a worker thread. Other processes reach them through an
+ * NFCSharedReaderProvider: each command travels through a memory ring shared
+ * with the daemon, which runs it on the real device.
+ *
+ * The daemon owns the devices while it runs, so the provider reader units must
+ * stay disconnected. Several clients may use the same reader, the daemon
+ * serializes their commands and gives each one back its device settings; a
+ * card selected by one client is not selected any more for the others.
+ *
+ * Only built with LLA_NFC_SHARED_READERS, which needs a Linux libnfc built
+ * with its shared driver.
+ */
+class LLA_READERS_NFC_NFC_API NFCReaderDaemon
+{
+  public:
+    /**
+     * \brief Constructor.
+     * \param provider The provider of the readers to share.
+     * \param socketPath The Unix socket to listen on.
+     */
+    explicit NFCReaderDaemon(std::shared_ptr<NFCReaderProvider> provider,
+                             const std::string &socketPath = NFC_SHARED_DEFAULT_SOCKET);
+
+    /**
+     * \brief Destructor, stops the daemon.
+     */
+    ~NFCReaderDaemon();
+
+    /**
+     * \brief Open the readers and start serving them.
+     */
+    void start();
+
+    /**
+     * \brief Disconnect the clients, close the readers and wait for the worker.
+     */
+    void stop();
+
+    /**
+     * \brief Get if the daemon runs.
+     * \return True if started.
+     */
+    bool isRunning() const;
+
+    /**
+     * \brief Get the Unix socket the daemon listens on.
+     * \return The socket path.
+     */
+    const std::string &getSocketPath() const
+    {
+        return d_socket_path;
+    }
+
+    /**
+     * \brief Get the connection strings of the shared readers.
+     * \return The local connection strings, empty when stopped.
+     */
+    std::vector<std::string> getSharedReaders() const;
+
+  protected:
+    /**
+     * \brief Close the readers and free the server.
+     */
+    void release();
+
+    std::shared_ptr<NFCReaderProvider> d_provider;
+
+    std::string d_socket_path;
+
+    nfc_shared_server *d_server;
+
+    std::vector<nfc_device *> d_devices;
+
+    std::atomic<bool> d_running;
+
+    std::thread d_worker;
+};
+#endif
+}
+
+#endif /* LOGICALACCESS_NFCREADERDAEMON_HPP */
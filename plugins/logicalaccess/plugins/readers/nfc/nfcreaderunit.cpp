@@ -11,6 +11,7 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
 
 #include <logicalaccess/dynlibrary/librarymanager.hpp>
 #include <logicalaccess/dynlibrary/idynlibrary.hpp>
@@ -20,6 +21,8 @@
 #include <logicalaccess/bufferhelper.hpp>
 #include <logicalaccess/readerproviders/readerprovider.hpp>
 #include <logicalaccess/cards/chip.hpp>
+#include <logicalaccess/cards/commands.hpp>
+#include <logicalaccess/cards/readercardadapter.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/date_time.hpp>
@@ -33,12 +36,18 @@
 #include <logicalaccess/readerproviders/readerunit.hpp>
 #include <nfc/nfc.h>
 
+#ifdef __unix__
+#include <time.h>
+#endif
+
 namespace logicalaccess
 {
 // Reader unit code for card detection based on libfreefare project
 
 #define NXP_MANUFACTURER_CODE 0x04
 #define MAX_CANDIDATES 16
+// Largest waiting time extension multiplier, ISO/IEC 14443-4 7.3
+#define MAX_WTXM 59
 
 struct supported_tag
 {
@@ -89,30 +98,105 @@ struct supported_tag supported_tags[] = {
     {"MifareUltralight", NMT_ISO14443A, 0x00, 0, 0, {0x00}, nullptr}, // Mifare UltraLight
 };
 
+namespace
+{
+/**
+ * \brief Get the CPU time of the calling thread.
+ * \return The CPU time, 0 where the platform cannot tell.
+ */
+std::chrono::microseconds getThreadCpuTime()
+{
+#if defined(__unix__) && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+    {
+        return std::chrono::microseconds(static_cast<long long>(ts.tv_sec) * 1000000 +
+                                         ts.tv_nsec / 1000);
+    }
+#endif
+    return std::chrono::microseconds(0);
+}
+
+// The pre-built Windows libnfc only has the baseline initiator functions. Without
+// them, a single target is activated and reselected by UID, polling is done in
+// software and no response time is sampled.
+
+int setCurrentTarget(nfc_device *device, const nfc_target *target)
+{
+#ifdef NFC_HAS_TARGET_TABLE
+    return nfc_initiator_set_current_target(device, target);
+#else
+    return NFC_EDEVNOTSUPP;
+#endif
+}
+
+int reselectTarget(nfc_device *device, const nfc_target *target)
+{
+#ifdef NFC_HAS_TARGET_TABLE
+    return nfc_initiator_reselect_target(device, target);
+#else
+    return NFC_EDEVNOTSUPP;
+#endif
+}
+
+int selectPassiveTargets(nfc_device *device, const nfc_modulation &modulation,
+                         nfc_target targets[], size_t count)
+{
+#ifdef NFC_HAS_TARGET_TABLE
+    return nfc_initiator_select_passive_targets(device, modulation, targets, count);
+#else
+    return count > 0
+               ? nfc_initiator_select_passive_target(device, modulation, nullptr, 0,
+                                                     &targets[0])
+               : 0;
+#endif
+}
+
+int autoPollTarget(nfc_device *device, const std::vector<nfc_modulation> &modulations,
+                   uint8_t period, nfc_target *target)
+{
+#ifdef NFC_HAS_AUTO_POLL
+    return nfc_initiator_auto_poll_target(device, modulations.data(), modulations.size(),
+                                          1, period, target);
+#else
+    return NFC_EDEVNOTSUPP;
+#endif
+}
+
+int lastResponseCycles(nfc_device *device, uint32_t *cycles)
+{
+#ifdef NFC_HAS_RESPONSE_CYCLES
+    return nfc_initiator_last_response_cycles(device, cycles);
+#else
+    return NFC_EDEVNOTSUPP;
+#endif
+}
+}
+
 NFCReaderUnit::NFCReaderUnit(const std::string &name)
     : ReaderUnit(READER_NFC)
     , d_name(name)
     , d_connectedName(name)
     , d_chip_connected(false)
     , d_device(nullptr)
+    , d_chip_snapshot(std::make_shared<const NFCChipSnapshot>())
+    , d_response_timer(-1)
+    , d_latency(0)
+    , d_latency_deviation(0)
+    , d_latency_samples(0)
+    , d_timeout_backoff(1)
+    , d_applied_revision(0)
+    , d_field_ready(false)
+    , d_idle(false)
+    , d_auto_poll(-1)
+    , d_polling_stats()
 {
     d_readerUnitConfig.reset(new NFCReaderUnitConfiguration());
     ReaderUnit::setDefaultReaderCardAdapter(std::make_shared<NFCReaderCardAdapter>());
 
     std::shared_ptr<NFCDataTransport> dataTransport(new NFCDataTransport());
     ReaderUnit::setDataTransport(dataTransport);
-    d_card_type = "UNKNOWN";
-
-    try
-    {
-        boost::property_tree::ptree pt;
-        read_xml((boost::filesystem::current_path().string() + "/NFCReaderUnit.config"),
-                 pt);
-        d_card_type = pt.get("config.cardType", "UNKNOWN");
-    }
-    catch (...)
-    {
-    }
+    d_card_type = NFCReaderUnitConfiguration::getDefaultCardType();
 }
 
 NFCReaderUnit::~NFCReaderUnit()
@@ -146,24 +230,89 @@ bool NFCReaderUnit::waitInsertion(unsigned int maxwait)
 
     if (d_device != nullptr)
     {
-        boost::posix_time::ptime currentDate =
-            boost::posix_time::second_clock::local_time();
-        boost::posix_time::ptime maxDate =
-            currentDate + boost::posix_time::milliseconds(maxwait);
+        waitPrefetch();
+        std::shared_ptr<NFCReaderUnitConfiguration> config = getNFCConfiguration();
+        std::chrono::steady_clock::time_point wait_until(
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(maxwait));
+        if (d_quiet_since == std::chrono::steady_clock::time_point())
+        {
+            d_quiet_since = std::chrono::steady_clock::now();
+        }
 
-        while (!inserted && currentDate < maxDate)
+        while (!inserted && std::chrono::steady_clock::now() < wait_until)
         {
-            refreshChipList();
-            if (d_chips.size() != 0)
+            std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+            std::chrono::microseconds cpu_start = getThreadCpuTime();
+            NFCPollModeStats &stats =
+                d_idle ? d_polling_stats.idle : d_polling_stats.active;
+            if (start < d_next_poll)
             {
-                d_insertedChip = d_chips.cbegin()->first;
-                inserted       = true;
+                // The poll period runs across calls, so short waits do not poll faster
+                std::this_thread::sleep_until(std::min(d_next_poll, wait_until));
             }
             else
             {
-                currentDate = boost::posix_time::second_clock::local_time();
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                bool idle = d_idle;
+                NFCResult<size_t> found =
+                    idle ? tryIdlePoll(wait_until) : tryRefreshChipList();
+                std::chrono::steady_clock::time_point now =
+                    std::chrono::steady_clock::now();
+                ++stats.polls;
+                if (!idle)
+                {
+                    stats.deviceTime +=
+                        std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                                              start);
+                }
+                // A marginal card answers with RF errors or timeouts, wait for the next
+                // poll instead of failing.
+                if (!found && found.error() != NFC_ERFTRANS &&
+                    found.error() != NFC_ETIMEOUT)
+                {
+                    found.rethrowException();
+                    THROW_EXCEPTION_WITH_LOG(LibLogicalAccessException,
+                                             "Cannot list the targets. " +
+                                                 found.message());
+                }
+                if (d_chips.size() != 0)
+                {
+                    if (idle)
+                    {
+                        LOG(DEBUGS) << "Card detected, leaving the idle mode.";
+                        ++d_polling_stats.wakeups;
+                        d_idle = false;
+                    }
+                    d_quiet_since  = now;
+                    d_insertedChip = d_chips.cbegin()->first;
+                    inserted       = true;
+                    publishChipSnapshot();
+                    startPrefetch(d_insertedChip);
+                }
+                else
+                {
+                    if (!d_idle && config->getIdleDelay() != 0 &&
+                        now - d_quiet_since >=
+                            std::chrono::milliseconds(config->getIdleDelay()))
+                    {
+                        LOG(DEBUGS) << "No card for " << config->getIdleDelay()
+                                    << " ms, entering the idle mode.";
+                        d_idle = true;
+                        if (config->getIdleLowPower())
+                        {
+                            // Failing to power the chip down only costs power
+                            nfc_idle(d_device);
+                            d_field_ready = false;
+                        }
+                    }
+                    d_next_poll = now + std::chrono::milliseconds(
+                                            d_idle ? config->getIdlePollPeriod()
+                                                   : config->getPollPeriod());
+                }
             }
+            stats.elapsed += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+            stats.cpuTime += getThreadCpuTime() - cpu_start;
         }
     }
     else
@@ -202,15 +351,20 @@ bool NFCReaderUnit::waitRemoval(unsigned int maxwait)
 
                 // We attempt to connect. If we failed to connect, that means the card
                 // has been removed.
-                removed = !connect();
+                NFCResult<bool> connected = tryConnect();
+                connected.rethrowException();
+                removed = !connected || !connected.value();
                 if (!removed)
                 {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    std::this_thread::sleep_for(std::chrono::milliseconds(
+                        getNFCConfiguration()->getPollPeriod()));
                 }
                 else
                 {
                     d_chips.clear();
                     d_insertedChip = nullptr;
+                    d_quiet_since  = std::chrono::steady_clock::now();
+                    publishChipSnapshot();
                 }
             }
         }
@@ -266,60 +420,500 @@ std::string NFCReaderUnit::getCardTypeFromTarget(nfc_target target) const
 
 bool NFCReaderUnit::connect()
 {
-    if (isConnected())
+    NFCResult<bool> res = tryConnect();
+    if (!res)
     {
-        LOG(LogLevel::ERRORS) << EXCEPTION_MSG_CONNECTED;
-        disconnect();
+        res.rethrowException();
+        LOG(ERRORS) << res.message();
+        return false;
     }
+    return res.value();
+}
 
-    bool connected = (d_chip_connected = false);
-
-    if (d_insertedChip && d_chips.find(d_insertedChip) != d_chips.end())
+NFCResult<bool> NFCReaderUnit::tryConnect() noexcept
+{
+    try
     {
-        if (d_chips[d_insertedChip].nm.nmt == NMT_ISO14443A)
+        if (isConnected())
         {
-            nfc_target pnti;
-            nfc_modulation modulation;
-            modulation.nmt = NMT_ISO14443A;
-            modulation.nbr = NBR_106;
+            LOG(LogLevel::ERRORS) << EXCEPTION_MSG_CONNECTED;
+            disconnect();
+        }
 
-            // prevent infinite wait. Setting this in connectToReader() did not work
-            // for unkown reason.
-            nfc_safe_call(nfc_device_set_property_bool, d_device, NP_INFINITE_SELECT,
-                          false);
+        bool connected = (d_chip_connected = false);
 
-            int ret = nfc_initiator_select_passive_target(
-                d_device, modulation, d_chips[d_insertedChip].nti.nai.abtUid,
-                d_chips[d_insertedChip].nti.nai.szUidLen, &pnti);
-            if (ret > 0)
+        waitPrefetch();
+        if (d_insertedChip && d_chips.find(d_insertedChip) != d_chips.end())
+        {
+            if (d_prefetch_chip == d_insertedChip)
             {
-                LOG(DEBUGS) << "Selected passive target.";
-                d_chip_connected = connected = true;
-                d_insertedChip->setChipIdentifier(
-                    getCardSerialNumber(d_chips[d_insertedChip]));
+                // The prefetch script just talked to the card: reselecting it would
+                // lose the state the prefetched responses rely on.
+                connected = setCurrentTarget(d_device, &d_chips[d_insertedChip]) ==
+                            NFC_SUCCESS;
             }
-            else if (ret == 0)
+            d_prefetch_chip.reset();
+            if (!connected && !resumeSession())
             {
-                LOG(DEBUGS) << "No target found when selecting passive NFC target.";
+                int res = reselectChipStatus(d_insertedChip);
+                if (res < 0)
+                    return NFCResult<bool>::failure(res);
+                connected = res > 0;
             }
-            else
+            d_chip_connected = connected;
+        }
+        return connected;
+    }
+    catch (...)
+    {
+        return NFCResult<bool>::failure(std::current_exception());
+    }
+}
+
+bool NFCReaderUnit::resumeSession()
+{
+    if (!d_session_chip)
+    {
+        return false;
+    }
+
+    waitPrefetch();
+    bool resumed = false;
+    auto it      = d_chips.find(d_session_chip);
+    if (d_session_chip == d_insertedChip && it != d_chips.end() &&
+        std::chrono::steady_clock::now() - d_session_idle_since <
+            std::chrono::milliseconds(getNFCConfiguration()->getSessionIdleTimeout()))
+    {
+        // The card never left the ACTIVE state, a presence check is enough.
+        resumed = setCurrentTarget(d_device, &it->second) == NFC_SUCCESS &&
+                  nfc_initiator_target_is_present(d_device, nullptr) == NFC_SUCCESS;
+    }
+
+    if (resumed)
+    {
+        LOG(DEBUGS) << "Resumed session with the activated target.";
+        d_session_chip.reset();
+    }
+    else
+    {
+        // Idle timeout or card removed.
+        releaseSession();
+    }
+    return resumed;
+}
+
+void NFCReaderUnit::startPrefetch(std::shared_ptr<Chip> chip)
+{
+    // Only ISO14443-4 commands can be sent without any prior authentication
+    const nfc_target &inserted = d_chips[chip];
+    if (inserted.nm.nmt != NMT_ISO14443A || !(inserted.nti.nai.btSak & 0x20))
+    {
+        return;
+    }
+    std::vector<std::vector<unsigned char>> script =
+        getNFCConfiguration()->getPrefetchScript(chip->getCardType());
+    if (script.empty() || !getChipDataTransport(chip))
+    {
+        return;
+    }
+
+    LOG(DEBUGS) << "Prefetching " << script.size() << " commands for "
+                << chip->getCardType() << ".";
+    nfc_device *device = d_device;
+    nfc_target target  = inserted;
+    long timeout       = getCommandTimeout(chip, 2000);
+    d_prefetch_chip    = chip;
+    // Every user of the device calls waitPrefetch() first.
+    d_prefetch = std::async(std::launch::async, [device, target, script,
+                                                 timeout]() mutable {
+        NFCPrefetchedResponses responses;
+        if (setCurrentTarget(device, &target) != NFC_SUCCESS)
+        {
+            return responses;
+        }
+        unsigned char returnedData[255];
+        for (const std::vector<unsigned char> &command : script)
+        {
+            int res = nfc_initiator_transceive_bytes(device, &command[0], command.size(),
+                                                     returnedData, sizeof(returnedData),
+                                                     timeout);
+            if (res < 0)
+            {
+                break;
+            }
+            responses.push_back(std::make_pair(
+                command, std::vector<unsigned char>(returnedData, returnedData + res)));
+        }
+        return responses;
+    });
+}
+
+void NFCReaderUnit::waitPrefetch()
+{
+    if (!d_prefetch.valid())
+    {
+        return;
+    }
+
+    NFCPrefetchedResponses responses = d_prefetch.get();
+    LOG(DEBUGS) << "Prefetched " << responses.size() << " responses.";
+    std::shared_ptr<NFCDataTransport> dt =
+        d_prefetch_chip ? getChipDataTransport(d_prefetch_chip) : nullptr;
+    if (dt && !responses.empty())
+    {
+        dt->setPrefetchedResponses(responses);
+    }
+    else
+    {
+        d_prefetch_chip.reset();
+    }
+}
+
+long NFCReaderUnit::getCommandTimeout(std::shared_ptr<Chip> chip, long maxTimeout)
+{
+    if (!getNFCConfiguration()->getAdaptiveTimeout() || d_latency_samples == 0)
+    {
+        return maxTimeout;
+    }
+
+    if (!chip)
+    {
+        chip = d_insertedChip;
+    }
+    std::chrono::microseconds fwt(0);
+    auto it = d_chips.find(chip);
+    if (it != d_chips.end() && it->second.nm.nmt == NMT_ISO14443A)
+    {
+        // The reader grants S(WTX) on its own, the host only sees a longer wait
+        fwt = getFrameWaitingTime(it->second.nti.nai) * MAX_WTXM;
+    }
+
+    // Same estimator as the TCP retransmission timer (RFC 6298)
+    std::chrono::microseconds timeout =
+        (fwt + d_latency + 4 * d_latency_deviation) * d_timeout_backoff;
+    long ms = static_cast<long>((timeout.count() + 999) / 1000);
+    ms      = std::max(ms, static_cast<long>(
+                              getNFCConfiguration()->getMinimumCommandTimeout()));
+    if (maxTimeout > 0)
+    {
+        ms = std::min(ms, maxTimeout);
+    }
+    return ms;
+}
+
+void NFCReaderUnit::recordCommandLatency(std::chrono::microseconds latency)
+{
+    if (d_latency_samples == 0)
+    {
+        d_latency           = latency;
+        d_latency_deviation = latency / 2;
+    }
+    else
+    {
+        std::chrono::microseconds delta =
+            (latency > d_latency) ? latency - d_latency : d_latency - latency;
+        d_latency_deviation = (3 * d_latency_deviation + delta) / 4;
+        d_latency           = (7 * d_latency + latency) / 8;
+    }
+    ++d_latency_samples;
+    d_timeout_backoff = 1;
+}
+
+void NFCReaderUnit::recordCommandTimeout()
+{
+    if (d_timeout_backoff < 64)
+    {
+        d_timeout_backoff *= 2;
+    }
+    LOG(DEBUGS) << "Command timed out, timeout multiplier is now " << d_timeout_backoff
+                << ".";
+}
+
+void NFCReaderUnit::profileResponseTime(std::shared_ptr<Chip> chip,
+                                        std::chrono::microseconds exchange)
+{
+    unsigned int interval = getNFCConfiguration()->getResponseTimeSampling();
+    if (d_response_timer == 0 || !d_response_time_profiler.sample(interval))
+    {
+        return;
+    }
+
+    waitPrefetch();
+    uint32_t cycles = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int res = lastResponseCycles(d_device, &cycles);
+    std::chrono::microseconds bus = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    if (res == NFC_EDEVNOTSUPP)
+    {
+        LOG(DEBUGS) << "The reader cannot time the card answers, no response time "
+                       "is sampled.";
+        d_response_timer = 0;
+        return;
+    }
+    if (res < 0)
+    {
+        LOG(DEBUGS) << "Unable to read the response time: " << res << ".";
+        return;
+    }
+    d_response_timer = 1;
+
+    if (!chip)
+    {
+        chip = d_insertedChip;
+    }
+    const std::string cardType = chip ? chip->getCardType() : "UNKNOWN";
+    d_response_time_profiler.record(cardType, cycles, exchange, bus);
+    LOG(LogLevel::COMS) << "Card response time: " << cycles << " cycles, exchange "
+                        << exchange.count() << " us, bus " << bus.count() << " us.";
+}
+
+void NFCReaderUnit::resetResponseTimeStatistics()
+{
+    d_response_time_profiler.reset();
+}
+
+std::chrono::microseconds
+NFCReaderUnit::getFrameWaitingTime(const nfc_iso14443a_info &nai)
+{
+    if (nai.szAtsLen == 0)
+    {
+        return std::chrono::microseconds(0);
+    }
+
+    // T0 (ISO/IEC 14443-4 5.2): TA1, TB1 and TC1 presence, TB1 upper nibble is FWI
+    uint8_t fwi = 4;
+    if ((nai.abtAts[0] & 0x20) != 0)
+    {
+        size_t tb1 = ((nai.abtAts[0] & 0x10) != 0) ? 2 : 1;
+        if (tb1 < nai.szAtsLen && (nai.abtAts[tb1] >> 4) != 15)
+        {
+            fwi = nai.abtAts[tb1] >> 4;
+        }
+    }
+    // FWT = 256 * 16 / fc * 2^FWI
+    return std::chrono::microseconds(302 << fwi);
+}
+
+std::shared_ptr<NFCDataTransport>
+NFCReaderUnit::getChipDataTransport(std::shared_ptr<Chip> chip)
+{
+    std::shared_ptr<Commands> commands = chip->getCommands();
+    if (!commands || !commands->getReaderCardAdapter())
+    {
+        return nullptr;
+    }
+    std::shared_ptr<NFCDataTransport> dt = std::dynamic_pointer_cast<NFCDataTransport>(
+        commands->getReaderCardAdapter()->getDataTransport());
+    // A transport bound to no chip serves the single activated one
+    return (dt && (!dt->getChip() || dt->getChip() == chip)) ? dt : nullptr;
+}
+
+void NFCReaderUnit::dropPrefetch()
+{
+    if (d_prefetch_chip)
+    {
+        std::shared_ptr<NFCDataTransport> dt = getChipDataTransport(d_prefetch_chip);
+        if (dt)
+        {
+            dt->clearPrefetchedResponses();
+        }
+        d_prefetch_chip.reset();
+    }
+}
+
+void NFCReaderUnit::bindTargetAdapter(std::shared_ptr<Chip> chip, size_t target)
+{
+    std::shared_ptr<Commands> commands = chip->getCommands();
+    if (!commands || getDataTransport())
+    {
+        return;
+    }
+
+    while (d_target_adapters.size() <= target)
+    {
+        std::shared_ptr<NFCReaderCardAdapter> rca = std::make_shared<NFCReaderCardAdapter>();
+        std::shared_ptr<NFCDataTransport> dt      = std::make_shared<NFCDataTransport>();
+        dt->setReaderUnit(shared_from_this());
+        rca->setDataTransport(dt);
+        d_target_adapters.push_back(rca);
+    }
+    std::shared_ptr<NFCReaderCardAdapter> rca = d_target_adapters[target];
+    std::shared_ptr<NFCDataTransport> dt =
+        std::dynamic_pointer_cast<NFCDataTransport>(rca->getDataTransport());
+    dt->clearPrefetchedResponses();
+    dt->setChip(chip);
+    rca->setResultChecker(
+        d_chip_factory.getResultChecker(d_chip_factory.getTypeId(chip->getCardType())));
+    commands->setReaderCardAdapter(rca);
+}
+
+void NFCReaderUnit::releaseSession()
+{
+    waitPrefetch();
+    if (d_session_chip)
+    {
+        LOG(DEBUGS) << "Deselecting target kept activated";
+        nfc_initiator_deselect_target(d_device);
+        d_session_chip.reset();
+    }
+}
+
+std::vector<std::shared_ptr<Chip>> NFCReaderUnit::connectChips()
+{
+    if (isConnected())
+    {
+        disconnect();
+    }
+
+    waitPrefetch();
+    d_prefetch_chip.reset();
+    std::vector<std::shared_ptr<Chip>> connected;
+    nfc_target targets[MAX_CANDIDATES];
+    nfc_modulation modulation;
+    modulation.nmt = NMT_ISO14443A;
+    modulation.nbr = NBR_106;
+
+    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_INFINITE_SELECT, false);
+    int count = selectPassiveTargets(d_device, modulation, targets, MAX_CANDIDATES);
+    if (count < 0)
+    {
+        LOG(ERRORS) << "NFC Error: " << nfc_strerror(d_device);
+    }
+
+    for (int t = 0; t < count; ++t)
+    {
+        std::vector<unsigned char> csn = getCardSerialNumber(targets[t]);
+        for (auto &chip_target : d_chips)
+        {
+            if (getCardSerialNumber(chip_target.second) == csn)
             {
-                LOG(ERRORS) << "NFC Error: " << nfc_strerror(d_device);
+                chip_target.second = targets[t];
+                chip_target.first->setChipIdentifier(csn);
+                // Each chip then reaches its own logical target
+                if (count > 1)
+                    bindTargetAdapter(chip_target.first, static_cast<size_t>(t));
+                connected.push_back(chip_target.first);
+                break;
             }
         }
     }
+    LOG(DEBUGS) << "Activated " << connected.size() << " passive targets.";
+
+    d_chip_connected = !connected.empty();
     return connected;
 }
 
+bool NFCReaderUnit::selectChip(std::shared_ptr<Chip> chip)
+{
+    auto it = d_chips.find(chip);
+    if (it == d_chips.end())
+    {
+        return false;
+    }
+
+    waitPrefetch();
+    // Activated targets are addressed by their logical number without any RF
+    // exchange.
+    if (setCurrentTarget(d_device, &it->second) == NFC_SUCCESS)
+    {
+        return true;
+    }
+    return reselectChip(chip);
+}
+
+bool NFCReaderUnit::reselectChip(std::shared_ptr<Chip> chip)
+{
+    int res = reselectChipStatus(chip);
+    if (res < 0)
+    {
+        LOG(ERRORS) << getNFCErrorMessage(res);
+    }
+    return res > 0;
+}
+
+int NFCReaderUnit::reselectChipStatus(std::shared_ptr<Chip> chip)
+{
+    auto it = d_chips.find(chip);
+    if (it == d_chips.end() || it->second.nm.nmt != NMT_ISO14443A)
+    {
+        return 0;
+    }
+
+    waitPrefetch();
+    // Still known by the reader: InSelect or WUPA and SELECT by UID is enough.
+    if (reselectTarget(d_device, &it->second) == NFC_SUCCESS)
+    {
+        LOG(DEBUGS) << "Reselected known passive target.";
+        chip->setChipIdentifier(getCardSerialNumber(it->second));
+        return 1;
+    }
+
+    nfc_target pnti;
+    nfc_modulation modulation;
+    modulation.nmt = NMT_ISO14443A;
+    modulation.nbr = NBR_106;
+
+    // prevent infinite wait. Setting this in connectToReader() did not work
+    // for unkown reason.
+    int ret = nfc_device_set_property_bool(d_device, NP_INFINITE_SELECT, false);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    ret = nfc_initiator_select_passive_target(d_device, modulation,
+                                              it->second.nti.nai.abtUid,
+                                              it->second.nti.nai.szUidLen, &pnti);
+    if (ret > 0)
+    {
+        LOG(DEBUGS) << "Selected passive target.";
+        chip->setChipIdentifier(getCardSerialNumber(it->second));
+    }
+    else if (ret == 0)
+    {
+        LOG(DEBUGS) << "No target found when selecting passive NFC target.";
+    }
+    return ret;
+}
+
 void NFCReaderUnit::disconnect()
 {
+    waitPrefetch();
+    d_prefetch_chip.reset();
+    if (d_insertedChip)
+    {
+        std::shared_ptr<NFCDataTransport> dt = getChipDataTransport(d_insertedChip);
+        if (dt)
+        {
+            dt->clearPrefetchedResponses();
+        }
+    }
+
     if (d_insertedChip && d_chips.find(d_insertedChip) != d_chips.end())
     {
-        if (d_chips[d_insertedChip].nm.nmt == NMT_ISO14443A)
+        const nfc_target &target = d_chips[d_insertedChip];
+        if (target.nm.nmt == NMT_ISO14443A)
         {
-            LOG(DEBUGS) << "Deselecting target";
-            nfc_initiator_deselect_target(d_device);
-            LOG(DEBUGS) << "Target deselected";
+            if (getNFCConfiguration()->getSessionIdleTimeout() > 0 &&
+                (target.nti.nai.btSak & 0x20))
+            {
+                // Keep the ISO14443-4 card activated, connect() will resume the
+                // session within the idle timeout.
+                if (d_chip_connected)
+                {
+                    LOG(DEBUGS) << "Keeping target activated";
+                    d_session_chip       = d_insertedChip;
+                    d_session_idle_since = std::chrono::steady_clock::now();
+                }
+            }
+            else
+            {
+                LOG(DEBUGS) << "Deselecting target";
+                d_session_chip.reset();
+                nfc_initiator_deselect_target(d_device);
+                LOG(DEBUGS) << "Target deselected";
+            }
         }
     }
     d_chip_connected = false;
@@ -328,32 +922,27 @@ void NFCReaderUnit::disconnect()
 std::shared_ptr<Chip> NFCReaderUnit::createChip(std::string type)
 {
     LOG(LogLevel::INFOS) << "Create chip " << type;
+    NFCCardTypeId typeId = d_chip_factory.getTypeId(type);
+    if (d_chip_factory.isUnsupported(typeId))
+    {
+        return nullptr;
+    }
     std::shared_ptr<Chip> chip = ReaderUnit::createChip(type);
 
-    if (chip)
+    if (!chip)
+    {
+        // Spare the card plugins lookup on the next detections
+        d_chip_factory.setUnsupported(typeId);
+    }
+    else
     {
         LOG(LogLevel::INFOS) << "Chip (" << chip->getCardType()
                              << ") created, creating other associated objects...";
 
         std::shared_ptr<ReaderCardAdapter> rca = getDefaultReaderCardAdapter();
-        std::shared_ptr<Commands> commands;
-        std::shared_ptr<ResultChecker> resultChecker(
-            new ISO7816ResultChecker()); // default one
-
-        if (type == "Mifare1K" || type == "Mifare4K" || type == "Mifare")
-        {
-            commands.reset(new MifareNFCCommands());
-        }
-        else if (type == "DESFireEV1")
-        {
-            commands.reset(new DESFireEV1ISO7816Commands());
-            resultChecker.reset(new DESFireISO7816ResultChecker());
-        }
-        else if (type == "DESFire")
-        {
-            commands.reset(new DESFireISO7816Commands());
-            resultChecker.reset(new DESFireISO7816ResultChecker());
-        }
+        std::shared_ptr<Commands> commands     = d_chip_factory.createCommands(typeId);
+        std::shared_ptr<ResultChecker> resultChecker =
+            d_chip_factory.getResultChecker(typeId);
 
         if (rca)
         {
@@ -387,86 +976,487 @@ std::shared_ptr<Chip> NFCReaderUnit::createChip(std::string type)
 
 std::shared_ptr<Chip> NFCReaderUnit::getSingleChip()
 {
-    std::shared_ptr<Chip> chip = d_insertedChip;
-    if (!chip)
+    std::shared_ptr<const NFCChipSnapshot> snapshot = getChipSnapshot();
+    std::shared_ptr<Chip> chip                     = snapshot->insertedChip;
+    if (!chip && !snapshot->chips.empty())
     {
-        std::vector<std::shared_ptr<Chip>> chips = getChipList();
-        if (chips.size() > 0)
-            chip = chips.front();
+        chip = snapshot->chips.front().chip;
     }
     return chip;
 }
 
 std::vector<std::shared_ptr<Chip>> NFCReaderUnit::getChipList()
 {
+    std::shared_ptr<const NFCChipSnapshot> snapshot = getChipSnapshot();
     std::vector<std::shared_ptr<Chip>> v;
-    for (std::map<std::shared_ptr<Chip>, nfc_target>::iterator it = d_chips.begin();
-         it != d_chips.end(); ++it)
+    v.reserve(snapshot->chips.size());
+    for (const NFCChipEntry &entry : snapshot->chips)
     {
-        v.push_back(it->first);
+        v.push_back(entry.chip);
     }
     return v;
 }
 
+std::shared_ptr<const NFCChipSnapshot> NFCReaderUnit::getChipSnapshot() const
+{
+    return std::atomic_load(&d_chip_snapshot);
+}
+
+void NFCReaderUnit::publishChipSnapshot()
+{
+    std::shared_ptr<NFCChipSnapshot> snapshot = std::make_shared<NFCChipSnapshot>();
+    snapshot->chips.reserve(d_chips.size());
+    for (const auto &chip_target : d_chips)
+    {
+        NFCChipEntry entry             = NFCChipEntry();
+        entry.chip                     = chip_target.first;
+        entry.nmt                      = chip_target.second.nm.nmt;
+        std::vector<unsigned char> csn = getCardSerialNumber(chip_target.second);
+        entry.serialNumberLength =
+            static_cast<uint8_t>(std::min(csn.size(), sizeof(entry.serialNumber)));
+        std::copy(csn.begin(), csn.begin() + entry.serialNumberLength,
+                  entry.serialNumber);
+        if (entry.nmt == NMT_ISO14443A)
+        {
+            memcpy(entry.atqa, chip_target.second.nti.nai.abtAtqa, sizeof(entry.atqa));
+            entry.sak = chip_target.second.nti.nai.btSak;
+        }
+        snapshot->chips.push_back(entry);
+    }
+    snapshot->insertedChip = d_insertedChip;
+    std::atomic_store(&d_chip_snapshot, std::shared_ptr<const NFCChipSnapshot>(snapshot));
+}
+
 void NFCReaderUnit::refreshChipList()
 {
-    nfc_safe_call(nfc_initiator_init, d_device);
+    NFCResult<size_t> res = tryRefreshChipList();
+    if (!res)
+    {
+        res.rethrowException();
+        THROW_EXCEPTION_WITH_LOG(LibLogicalAccessException,
+                                 "Cannot list the targets. " + res.message());
+    }
+}
 
-    // Drop the field for a while
-    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_ACTIVATE_FIELD, false);
+NFCResult<size_t> NFCReaderUnit::tryRefreshChipList() noexcept
+{
+    try
+    {
+        ChipSnapshotGuard snapshot_guard(*this);
+        waitPrefetch();
+        std::shared_ptr<NFCReaderUnitConfiguration> config = getNFCConfiguration();
+        int res = applyConfiguration();
+        if (res < 0)
+            return NFCResult<size_t>::failure(res);
+
+        // Polling ends any session kept activated.
+        d_session_chip.reset();
+        dropPrefetch();
+        if (!d_field_ready || config->getFieldResetPolicy() == FRP_ALWAYS)
+        {
+            // Drop the field for a while, configure the CRC and Parity settings, then
+            // enable field so more power consuming cards can power themselves up
+            static const std::pair<nfc_property, bool> properties[] = {
+                {NP_ACTIVATE_FIELD, false}, {NP_HANDLE_CRC, true},
+                {NP_HANDLE_PARITY, true},   {NP_AUTO_ISO14443_4, true},
+                {NP_ACTIVATE_FIELD, true}};
+            if ((res = nfc_initiator_init(d_device)) < 0)
+                return NFCResult<size_t>::failure(res);
+            for (const std::pair<nfc_property, bool> &property : properties)
+            {
+                if ((res = nfc_device_set_property_bool(d_device, property.first,
+                                                        property.second)) < 0)
+                    return NFCResult<size_t>::failure(res);
+            }
+            d_field_ready = true;
+        }
 
-    // Configure the CRC and Parity settings
-    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_HANDLE_CRC, true);
-    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_HANDLE_PARITY, true);
-    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_AUTO_ISO14443_4, true);
+        // libnfc lists as many targets as the chip can activate per
+        // InListPassiveTarget command, so two cards on the field are discovered in a
+        // single exchange.
+        std::vector<nfc_modulation> modulations;
+        for (const nfc_modulation &modulation : config->getPollModulations())
+        {
+            const nfc_baud_rate *supported = nullptr;
+            if (config->getBitRatePolicy() == BRP_CONFIGURED ||
+                nfc_device_get_supported_baud_rate(d_device, modulation.nmt,
+                                                   &supported) != NFC_SUCCESS ||
+                supported[0] == 0)
+            {
+                modulations.push_back(modulation);
+                continue;
+            }
+            // Supported bit rates are listed highest first
+            for (size_t i = 0; supported[i] != 0; ++i)
+            {
+                modulations.push_back({modulation.nmt, supported[i]});
+                if (config->getBitRatePolicy() == BRP_HIGHEST)
+                    break;
+            }
+        }
 
-    // Enable field so more power consuming cards can power themselves up
-    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_ACTIVATE_FIELD, true);
+        std::vector<size_t> order;
+        if (config->getAdaptivePolling())
+        {
+            d_poll_scheduler.setModulations(modulations);
+            order = d_poll_scheduler.schedule(config->getPollProbeInterval());
+        }
+        else
+        {
+            for (size_t i = 0; i < modulations.size(); ++i)
+                order.push_back(i);
+        }
 
-    // Poll for a ISO14443A (MIFARE) tag
-    nfc_target candidates[MAX_CANDIDATES];
-    int candidates_count;
-    nfc_modulation modulation;
-    modulation.nmt = NMT_ISO14443A;
-    modulation.nbr = NBR_106;
-    if ((candidates_count = nfc_initiator_list_passive_targets(
-             d_device, modulation, candidates, MAX_CANDIDATES)) < 0)
-        throw LibLogicalAccessException(
-            "ISO14443A nfc_initiator_list_passive_targets error");
+        nfc_target candidates[MAX_CANDIDATES];
+        for (size_t index : order)
+        {
+            std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+            int candidates_count = nfc_initiator_list_passive_targets(
+                d_device, modulations[index], candidates, MAX_CANDIDATES);
+            if (candidates_count < 0)
+                return NFCResult<size_t>::failure(candidates_count);
+
+            for (int c = 0; c < candidates_count; c++)
+            {
+                std::string ctype = getCardTypeFromTarget(candidates[c]);
+                if (ctype != "")
+                {
+                    std::shared_ptr<Chip> chip = createChip(ctype);
+                    if (chip)
+                    {
+                        d_chips[chip] = candidates[c];
+                    }
+                }
+            }
+            if (config->getAdaptivePolling())
+            {
+                d_poll_scheduler.record(
+                    index,
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start),
+                    candidates_count > 0);
+            }
+            // Spare the modulations left, their cards are missed meanwhile
+            if (config->getPollEarlyExit() && candidates_count > 0)
+                break;
+        }
+        return d_chips.size();
+    }
+    catch (...)
+    {
+        return NFCResult<size_t>::failure(std::current_exception());
+    }
+}
 
-    for (int c = 0; c < candidates_count; c++)
+NFCResult<size_t>
+NFCReaderUnit::tryIdlePoll(std::chrono::steady_clock::time_point wait_until) noexcept
+{
+    try
     {
-        std::string ctype = getCardTypeFromTarget(candidates[c]);
-        if (ctype != "")
+        waitPrefetch();
+        std::shared_ptr<NFCReaderUnitConfiguration> config = getNFCConfiguration();
+        NFCPollModeStats &stats                 = d_polling_stats.idle;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::milliseconds window =
+            std::min(std::chrono::milliseconds(config->getIdlePollPeriod()),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(wait_until -
+                                                                           start));
+        // InAutoPoll spends at least 150 ms per target type, a shorter wait would
+        // overshoot its deadline
+        if (config->getIdleLowPower() && d_auto_poll != 0 &&
+            window >= std::chrono::milliseconds(150) *
+                          getAutoPollTypes(config->getPollModulations()))
         {
-            std::shared_ptr<Chip> chip = createChip(ctype);
-            if (chip)
+            int res = autoPoll(window);
+            if (res >= 0)
+            {
+                d_auto_poll = 1;
+            }
+            if (res == 0)
             {
-                d_chips[chip] = candidates[c];
+                res = nfc_idle(d_device);
+                stats.deviceTime += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start);
+                if (res < 0)
+                    return NFCResult<size_t>::failure(res);
+                return d_chips.size();
             }
+            if (res == NFC_EDEVNOTSUPP)
+            {
+                // Only the PN532 has InAutoPoll
+                LOG(INFOS) << "The reader chip cannot poll by itself.";
+                d_auto_poll = 0;
+            }
+            else if (res == NFC_EINVARG)
+            {
+                LOG(INFOS) << "The poll modulations cannot be polled by the reader chip.";
+                d_auto_poll = 0;
+            }
+            else if (res < 0)
+            {
+                return NFCResult<size_t>::failure(res);
+            }
+            // The chip waited for the card, list the cards the usual way
+        }
+
+        NFCResult<size_t> found = tryRefreshChipList();
+        if (found && d_chips.empty() && config->getIdleLowPower())
+        {
+            int res       = nfc_idle(d_device);
+            d_field_ready = false;
+            if (res < 0)
+                found = NFCResult<size_t>::failure(res);
         }
+        stats.deviceTime += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        return found;
     }
+    catch (...)
+    {
+        return NFCResult<size_t>::failure(std::current_exception());
+    }
+}
+
+size_t NFCReaderUnit::getAutoPollTypes(const std::vector<nfc_modulation> &modulations)
+{
+    size_t types = modulations.size();
+    for (const nfc_modulation &modulation : modulations)
+    {
+        // libnfc polls ISO14443-4 cards apart to get their ATS
+        if (modulation.nmt == NMT_ISO14443A && modulation.nbr == NBR_106)
+            ++types;
+    }
+    return types;
+}
+
+int NFCReaderUnit::autoPoll(std::chrono::milliseconds window)
+{
+    std::vector<nfc_modulation> modulations = getNFCConfiguration()->getPollModulations();
+    if (modulations.empty())
+        return 0;
+
+    int res = applyConfiguration();
+    if (res < 0)
+        return res;
+    // The chip is set up again before the next regular poll
+    d_field_ready = false;
+    if ((res = nfc_initiator_init(d_device)) < 0)
+        return res;
+
+    // Each target type is polled once per period, from 1 to 15 units of 150 ms
+    long long period =
+        window.count() / (150 * static_cast<long long>(getAutoPollTypes(modulations)));
+    period = std::max(1LL, std::min(15LL, period));
+    nfc_target target;
+    res = autoPollTarget(d_device, modulations, static_cast<uint8_t>(period), &target);
+    if (res < 0)
+        return res;
+    return res > 0 ? 1 : 0;
+}
+
+void NFCReaderUnit::resetPollingStats()
+{
+    d_polling_stats = NFCPollingStats();
+}
+
+int NFCReaderUnit::applyConfiguration()
+{
+    waitPrefetch();
+    std::shared_ptr<NFCReaderUnitConfiguration> config = getNFCConfiguration();
+    if (d_device == nullptr || !config ||
+        (d_applied_configuration.lock() == config &&
+         config->getRevision() == d_applied_revision))
+    {
+        return NFC_SUCCESS;
+    }
+
+    LOG(DEBUGS) << "Applying the reader configuration (revision "
+                << config->getRevision() << ").";
+    const std::pair<nfc_property, int> timeouts[] = {
+        {NP_TIMEOUT_COMMAND, config->getTimeoutCommand()},
+        {NP_TIMEOUT_ATR, config->getTimeoutAtr()},
+        {NP_TIMEOUT_COM, config->getTimeoutCommunication()}};
+    for (const std::pair<nfc_property, int> &timeout : timeouts)
+    {
+        int res = nfc_device_set_property_int(d_device, timeout.first, timeout.second);
+        if (res < 0)
+            return res;
+    }
+    d_applied_configuration = config;
+    d_applied_revision      = config->getRevision();
+    return NFC_SUCCESS;
+}
+
+std::vector<NFCInventoryTag> NFCReaderUnit::inventory(size_t maxTags,
+                                                      NFCInventoryStats *stats)
+{
+    if (d_device == nullptr)
+    {
+        THROW_EXCEPTION_WITH_LOG(
+            LibLogicalAccessException,
+            "No underlying libnfc reader associated with this object.");
+    }
+    if (isConnected())
+    {
+        disconnect();
+    }
+    waitPrefetch();
+    // Dropping the field below ends any session kept activated.
+    d_session_chip.reset();
+    dropPrefetch();
+
+    std::vector<NFCInventoryTag> tags;
+    size_t collisions              = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    nfc_safe_call(nfc_initiator_init, d_device);
+    // Wake up the tags halted by a previous inventory
+    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_ACTIVATE_FIELD, false);
+    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_INFINITE_SELECT, false);
+    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_HANDLE_PARITY, true);
+    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_HANDLE_CRC, false);
+    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_EASY_FRAMING, false);
+    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_AUTO_ISO14443_4, false);
+    nfc_safe_call(nfc_device_set_property_bool, d_device, NP_ACTIVATE_FIELD, true);
 
-    // Poll for a FELICA tag
-    modulation.nmt = NMT_FELICA;
-    modulation.nbr = NBR_424; // FIXME NBR_212 should also be supported
-    if ((candidates_count = nfc_initiator_list_passive_targets(
-             d_device, modulation, candidates, MAX_CANDIDATES)) < 0)
-        throw LibLogicalAccessException(
-            "FELICA nfc_initiator_list_passive_targets error");
+    uint8_t abtReqa[1] = {0x26};
+    uint8_t abtHlta[4] = {0x50, 0x00, 0x00, 0x00};
+    uint8_t abtRx[8];
+    iso14443a_crc_append(abtHlta, 2);
 
-    for (int c = 0; c < candidates_count; c++)
+    while (maxTags == 0 || tags.size() < maxTags)
     {
-        std::string ctype = getCardTypeFromTarget(candidates[c]);
-        if (ctype != "")
+        NFCInventoryTag tag;
+        memset(&tag, 0x00, sizeof(tag));
+
+        // Halted tags do not answer REQA: the field is empty once all of them are
+        // listed.
+        int res = nfc_initiator_transceive_bits(d_device, abtReqa, 7, nullptr, abtRx,
+                                                sizeof(abtRx), nullptr);
+        bool selected = false;
+        if (res == 16)
+        {
+            // ATQA is received LSB first, it is kept as libnfc does
+            tag.atqa[0] = abtRx[1];
+            tag.atqa[1] = abtRx[0];
+            selected = inventorySelect(tag);
+        }
+        if (!selected)
+        {
+            // Colliding ATQA or UID bits. The bit collision position is not
+            // available from libnfc, so the reader chip resolves it, one tag at a
+            // time.
+            nfc_target nt;
+            nfc_modulation modulation;
+            modulation.nmt = NMT_ISO14443A;
+            modulation.nbr = NBR_106;
+            if (nfc_initiator_select_passive_target(d_device, modulation, nullptr, 0,
+                                                    &nt) <= 0)
+            {
+                break;
+            }
+            ++collisions;
+            tag.uidLength = static_cast<uint8_t>(
+                std::min(nt.nti.nai.szUidLen, sizeof(tag.uid)));
+            memcpy(tag.uid, nt.nti.nai.abtUid, tag.uidLength);
+            memcpy(tag.atqa, nt.nti.nai.abtAtqa, 2);
+            tag.sak     = nt.nti.nai.btSak;
+            // InListPassiveTarget turns the CRC back on in the chip
+            nfc_device_set_property_bool(d_device, NP_HANDLE_CRC, true);
+            nfc_device_set_property_bool(d_device, NP_HANDLE_CRC, false);
+        }
+
+        // A tag that does not halt would be listed again and again
+        bool known = false;
+        for (const NFCInventoryTag &other : tags)
         {
-            std::shared_ptr<Chip> chip = createChip(ctype);
-            if (chip)
+            if (other.uidLength == tag.uidLength &&
+                memcmp(other.uid, tag.uid, tag.uidLength) == 0)
             {
-                d_chips[chip] = candidates[c];
+                known = true;
+                break;
             }
         }
+        if (known)
+        {
+            LOG(WARNINGS) << "Tag " << BufferHelper::getHex(std::vector<unsigned char>(
+                                           tag.uid, tag.uid + tag.uidLength))
+                          << " does not halt, inventory stopped.";
+            break;
+        }
+        tags.push_back(tag);
+
+        // HLTA is never answered
+        nfc_initiator_transceive_bytes(d_device, abtHlta, sizeof(abtHlta), nullptr, 0, 0);
+    }
+
+    nfc_device_set_property_bool(d_device, NP_HANDLE_CRC, true);
+    nfc_device_set_property_bool(d_device, NP_EASY_FRAMING, true);
+    nfc_device_set_property_bool(d_device, NP_AUTO_ISO14443_4, true);
+    // The next poll must wake the halted tags up
+    d_field_ready = false;
+
+    std::chrono::microseconds elapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    double tagsPerSecond =
+        elapsed.count() > 0 ? tags.size() * 1e6 / elapsed.count() : 0.0;
+    LOG(INFOS) << "Inventory found " << tags.size() << " tags (" << collisions
+               << " collisions) in " << elapsed.count() << " us, " << tagsPerSecond
+               << " tags/s.";
+
+    if (stats)
+    {
+        stats->tags          = tags.size();
+        stats->collisions    = collisions;
+        stats->elapsed       = elapsed;
+        stats->tagsPerSecond = tagsPerSecond;
     }
+    return tags;
+}
+
+bool NFCReaderUnit::inventorySelect(NFCInventoryTag &tag) const
+{
+    static const uint8_t selectCommands[] = {0x93, 0x95, 0x97};
+    uint8_t abtRx[8];
+
+    for (uint8_t sel : selectCommands)
+    {
+        // ANTICOLLISION: 4 bytes of the UID and their BCC
+        uint8_t abtAnticol[2] = {sel, 0x20};
+        if (nfc_initiator_transceive_bytes(d_device, abtAnticol, sizeof(abtAnticol),
+                                           abtRx, sizeof(abtRx), 0) != 5 ||
+            (abtRx[0] ^ abtRx[1] ^ abtRx[2] ^ abtRx[3]) != abtRx[4])
+        {
+            return false;
+        }
+
+        uint8_t abtSelect[9] = {sel, 0x70};
+        memcpy(abtSelect + 2, abtRx, 5);
+        iso14443a_crc_append(abtSelect, 7);
+        if (nfc_initiator_transceive_bytes(d_device, abtSelect, sizeof(abtSelect), abtRx,
+                                           sizeof(abtRx), 0) != 3)
+        {
+            return false;
+        }
+
+        // The SAK cascade bit tells the UID goes on after the cascade tag
+        bool cascade = (abtRx[0] & 0x04) != 0;
+        if (cascade && tag.uidLength + 3u < sizeof(tag.uid))
+        {
+            memcpy(tag.uid + tag.uidLength, abtSelect + 3, 3);
+            tag.uidLength += 3;
+        }
+        else
+        {
+            memcpy(tag.uid + tag.uidLength, abtSelect + 2, 4);
+            tag.uidLength += 4;
+            tag.sak = abtRx[0];
+            return true;
+        }
+    }
+    return false;
 }
 
 std::vector<unsigned char> NFCReaderUnit::getCardSerialNumber(nfc_target target)
@@ -528,6 +1518,13 @@ bool NFCReaderUnit::connectToReader()
     {
         LOG(ERRORS) << "Failed to instanciate NFC device.";
     }
+    d_applied_configuration.reset();
+    d_field_ready           = false;
+    d_idle                  = false;
+    d_quiet_since           = std::chrono::steady_clock::now();
+    d_next_poll             = std::chrono::steady_clock::time_point();
+    d_auto_poll             = -1;
+    d_response_timer        = -1;
     return (d_device != nullptr);
 }
 
@@ -535,6 +1532,9 @@ void NFCReaderUnit::disconnectFromReader()
 {
     if (d_device != nullptr)
     {
+        waitPrefetch();
+        d_session_chip.reset();
+        dropPrefetch();
         nfc_close(d_device);
         d_device = nullptr;
     }
@@ -569,16 +1569,22 @@ NFCReaderUnit::createNFCReaderUnit(const std::string &readerName)
 
 std::vector<unsigned char> NFCReaderUnit::getNumber(std::shared_ptr<Chip> chip)
 {
-    if (d_chips.count(chip))
+    std::shared_ptr<const NFCChipSnapshot> snapshot = getChipSnapshot();
+    for (const NFCChipEntry &entry : snapshot->chips)
     {
-        return getCardSerialNumber(d_chips.at(chip));
+        if (entry.chip == chip)
+        {
+            return std::vector<unsigned char>(
+                entry.serialNumber, entry.serialNumber + entry.serialNumberLength);
+        }
     }
     return ReaderUnit::getNumber(chip);
 }
 
 std::vector<uint8_t> NFCReaderUnit::transmitBits(const uint8_t *pbtTx,
-                                                 const size_t szTxBits) const
+                                                 const size_t szTxBits)
 {
+    waitPrefetch();
     const int MAX_FRAME_LEN = 264;
     uint8_t abtRx[MAX_FRAME_LEN];
     int szRxBits;
@@ -600,6 +1606,8 @@ std::vector<uint8_t> NFCReaderUnit::transmitBits(const uint8_t *pbtTx,
 void NFCReaderUnit::writeChipUid(std::shared_ptr<Chip> c,
                                  const std::vector<uint8_t> &new_uid)
 {
+    // The guard sets the device up right away
+    waitPrefetch();
     WriteUIDConfigGuard config_guard(*this);
     assert(new_uid.size() == 4);
     LOG(DEBUGS) << "Attempting to change the UID of a card. "
@@ -639,6 +1647,7 @@ void NFCReaderUnit::writeChipUid(std::shared_ptr<Chip> c,
         nfct.nti.nai.abtUid[i] = new_uid[i];
     d_chips[c]                 = nfct;
     c->setChipIdentifier(new_uid);
+    publishChipSnapshot();
 }
 
 NFCReaderUnit::WriteUIDConfigGuard::WriteUIDConfigGuard(NFCReaderUnit &ru)
@@ -679,6 +1688,23 @@ NFCReaderUnit::WriteUIDConfigGuard::~WriteUIDConfigGuard()
         ->ignoreAllError(dt_error_flag_);
 }
 
+NFCReaderUnit::ChipSnapshotGuard::ChipSnapshotGuard(NFCReaderUnit &ru)
+    : ru_(ru)
+{
+}
+
+NFCReaderUnit::ChipSnapshotGuard::~ChipSnapshotGuard()
+{
+    try
+    {
+        ru_.publishChipSnapshot();
+    }
+    catch (std::exception &ex)
+    {
+        LOG(ERRORS) << "Cannot publish the chip snapshot: " << ex.what();
+    }
+}
+
 std::string NFCReaderUnit::fetchRealName()
 {
     if (d_device)
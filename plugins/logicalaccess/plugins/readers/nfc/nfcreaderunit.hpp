@@ -9,20 +9,120 @@
 
 #include <logicalaccess/readerproviders/readerunit.hpp>
 #include <logicalaccess/plugins/readers/nfc/nfcreaderunitconfiguration.hpp>
+#include <logicalaccess/plugins/readers/nfc/nfcchipfactory.hpp>
+#include <logicalaccess/plugins/readers/nfc/nfcpollscheduler.hpp>
+#include <logicalaccess/plugins/readers/nfc/nfcresponsetimeprofiler.hpp>
+#include <logicalaccess/plugins/readers/nfc/nfcresult.hpp>
 #include <logicalaccess/plugins/readers/nfc/lla_readers_nfc_nfc_api.hpp>
 #include <logicalaccess/plugins/llacommon/logs.hpp>
 #include <logicalaccess/myexception.hpp>
 
 #include <nfc/nfc.h>
 #include <map>
+#include <chrono>
+#include <deque>
+#include <future>
 
 namespace logicalaccess
 {
 class Profile;
 class NFCReaderCardAdapter;
+class NFCDataTransport;
 class NFCReaderProvider;
 class MifareClassicUIDChangerCardService;
 
+/**
+ * \brief An ISO14443-A tag found by an inventory, without any Chip object.
+ */
+struct NFCInventoryTag
+{
+    uint8_t uid[10];
+    uint8_t uidLength;
+    uint8_t atqa[2];
+    uint8_t sak;
+};
+
+/**
+ * \brief Statistics of an inventory.
+ */
+struct NFCInventoryStats
+{
+    size_t tags;
+    /**
+     * \brief Collisions resolved by the reader chip anticollision.
+     */
+    size_t collisions;
+    std::chrono::microseconds elapsed;
+    double tagsPerSecond;
+};
+
+/**
+ * \brief What waiting for cards cost in one polling mode.
+ */
+struct NFCPollModeStats
+{
+    size_t polls;
+    /**
+     * \brief The time spent waiting for a card.
+     */
+    std::chrono::microseconds elapsed;
+    /**
+     * \brief The time the host spent exchanging frames with the reader. A PN532
+     * polling by itself does not count.
+     */
+    std::chrono::microseconds deviceTime;
+    /**
+     * \brief The CPU time of the waiting thread, 0 where the platform cannot tell.
+     */
+    std::chrono::microseconds cpuTime;
+};
+
+/**
+ * \brief What waiting for cards cost, in the active and idle modes.
+ *
+ * deviceTime / elapsed is the bus utilisation, cpuTime / elapsed the CPU load.
+ */
+struct NFCPollingStats
+{
+    NFCPollModeStats active;
+    NFCPollModeStats idle;
+    /**
+     * \brief The cards detected by an idle reader.
+     */
+    size_t wakeups;
+};
+
+/**
+ * \brief A detected chip, with what identifies it on the field.
+ */
+struct NFCChipEntry
+{
+    std::shared_ptr<Chip> chip;
+    nfc_modulation_type nmt;
+    uint8_t serialNumber[10];
+    uint8_t serialNumberLength;
+    /**
+     * \brief ISO14443-A ATQA and SAK, zero for other modulations.
+     */
+    uint8_t atqa[2];
+    uint8_t sak;
+};
+
+/**
+ * \brief The chips detected by a poll. Never modified once published.
+ */
+struct NFCChipSnapshot
+{
+    std::vector<NFCChipEntry> chips;
+    std::shared_ptr<Chip> insertedChip;
+};
+
+/**
+ * \brief Commands sent ahead to a card, each with the card response.
+ */
+typedef std::deque<std::pair<std::vector<unsigned char>, std::vector<unsigned char>>>
+    NFCPrefetchedResponses;
+
 /**
  * \brief The NFC reader unit class.
  */
@@ -85,8 +185,23 @@ class LLA_READERS_NFC_NFC_API NFCReaderUnit : public ReaderUnit
      */
     std::shared_ptr<Chip> createChip(std::string type) override;
 
+    /**
+     * \brief Get the serial number of a detected chip.
+     * \param chip The chip.
+     * \return The chip serial number.
+     *
+     * Safe to call from any thread, like getSingleChip() and getChipList().
+     */
     std::vector<unsigned char> getNumber(std::shared_ptr<Chip> chip) override;
 
+    /**
+     * \brief Get the chips detected by the last poll.
+     * \return The snapshot, replaced as a whole by the next poll.
+     *
+     * Any thread can read it without lock while the reader polls.
+     */
+    std::shared_ptr<const NFCChipSnapshot> getChipSnapshot() const;
+
     /**
              * \brief Get the first and/or most accurate chip found.
              * \return The single chip.
@@ -108,11 +223,148 @@ class LLA_READERS_NFC_NFC_API NFCReaderUnit : public ReaderUnit
      */
     bool connect() override;
 
+    /**
+     * \brief Connect to the card, without throwing.
+     * \return True if the card was connected, or the libnfc error.
+     * \see connect
+     */
+    NFCResult<bool> tryConnect() noexcept;
+
+    /**
+     * \brief Activate several cards at once, up to the reader limit (two on PN53x).
+     * \return The chips now activated.
+     *
+     * When several cards are activated, each chip keeps its own logical target:
+     * commands sent through a chip are routed to it without reselecting the card. A
+     * forced data transport is kept, all the commands then go to the current target.
+     */
+    std::vector<std::shared_ptr<Chip>> connectChips();
+
+    /**
+     * \brief Route further exchanges to a chip.
+     * \param chip The chip.
+     * \return True if the chip can be addressed.
+     *
+     * Switching between activated chips costs no RF exchange, other chips are
+     * reselected.
+     */
+    bool selectChip(std::shared_ptr<Chip> chip);
+
+    /**
+     * \brief Reselect a chip, dropping the other activated ones.
+     *
+     * A chip still known by the reader is reactivated without anticollision, a
+     * full selection by UID is only done as fallback.
+     * \param chip The chip.
+     * \return True if the chip was selected.
+     */
+    bool reselectChip(std::shared_ptr<Chip> chip);
+
+    /**
+     * \brief Wait for the prefetch script of the inserted chip to be over.
+     *
+     * The prefetched responses are then handed to the data transport of the
+     * chip. Called before any use of the device, so that the prefetch never
+     * runs concurrently.
+     */
+    void waitPrefetch();
+
+    /**
+     * \brief Get the timeout of a command sent to a chip.
+     * \param chip The chip, or null for the inserted one.
+     * \param maxTimeout The timeout asked by the caller, in milliseconds. 0 or less
+     * for no limit.
+     * \return The timeout to give libnfc, in milliseconds.
+     *
+     * The timeout is the chip frame waiting time, from the FWI of its ATS, extended
+     * by the largest WTXM a card may ask for (ISO/IEC 14443-4 7.3), plus the latency
+     * observed on this reader. It doubles after each timeout, until a command
+     * succeeds again. maxTimeout is used as is until a latency is known, or if
+     * adaptive timeouts are disabled.
+     */
+    long getCommandTimeout(std::shared_ptr<Chip> chip, long maxTimeout);
+
+    /**
+     * \brief Account the latency of a successful command.
+     * \param latency The time the command took.
+     */
+    void recordCommandLatency(std::chrono::microseconds latency);
+
+    /**
+     * \brief Account a command that timed out.
+     */
+    void recordCommandTimeout();
+
+    /**
+     * \brief Time the card answer to the exchange just done, if it is sampled.
+     * \param chip The chip, or null for the inserted one.
+     * \param exchange The time the exchange took.
+     *
+     * Must be called right after the exchange, before any other command: the
+     * timer of the reader chip is read. Does nothing unless the response time
+     * sampling is enabled, or if the reader has no such timer.
+     */
+    void profileResponseTime(std::shared_ptr<Chip> chip,
+                             std::chrono::microseconds exchange);
+
+    /**
+     * \brief Get the card response times sampled since the last reset.
+     * \return The statistics by card type, only to be read from the thread
+     * sending the commands.
+     */
+    const std::map<std::string, NFCResponseTimeStatistics> &
+    getResponseTimeStatistics() const
+    {
+        return d_response_time_profiler.getStatistics();
+    }
+
+    /**
+     * \brief Reset the card response time statistics.
+     */
+    void resetResponseTimeStatistics();
+
+    /**
+     * \brief List the ISO14443-A tags on the field, halting each one in turn.
+     * \param maxTags The maximum number of tags to list, 0 for no limit.
+     * \param stats Filled with the inventory statistics, if not null.
+     * \return The tags found, in the order they were selected.
+     *
+     * REQA, ANTICOLLISION, SELECT and HLTA are sent as raw frames: no Chip is
+     * created and the chip list is left untouched. Tags stay halted until the
+     * field is reset, so any connected card is disconnected first.
+     */
+    std::vector<NFCInventoryTag> inventory(size_t maxTags        = 0,
+                                           NFCInventoryStats *stats = nullptr);
+
+    /**
+     * \brief Get what waiting for cards cost since the last reset.
+     * \return The polling statistics.
+     */
+    const NFCPollingStats &getPollingStats() const
+    {
+        return d_polling_stats;
+    }
+
+    /**
+     * \brief Reset the polling statistics.
+     */
+    void resetPollingStats();
+
+    /**
+     * \brief Get if the reader is idle, polled at the idle poll period.
+     * \return True if idle.
+     */
+    bool isIdle() const
+    {
+        return d_idle;
+    }
+
     /**
      * \brief Disconnect from the reader.
      * \see connect
      *
-     * Calling this method on a disconnected reader has no effect.
+     * Calling this method on a disconnected reader has no effect. An ISO14443-4
+     * card stays activated if a session idle timeout is configured.
      */
     void disconnect() override;
 
@@ -189,6 +441,15 @@ class LLA_READERS_NFC_NFC_API NFCReaderUnit : public ReaderUnit
      */
     std::string fetchRealName();
 
+    /**
+     * \brief Get what the adaptive polling observed of each poll modulation.
+     * \return The statistics, only to be read from the polling thread.
+     */
+    const std::vector<NFCPollStatistics> &getPollStatistics() const
+    {
+        return d_poll_scheduler.getStatistics();
+    }
+
   protected:
     /**
      * Requests the change of an UID for a card.
@@ -199,17 +460,132 @@ class LLA_READERS_NFC_NFC_API NFCReaderUnit : public ReaderUnit
 
     void refreshChipList();
 
+    /**
+     * \brief Publish a snapshot of the detected chips.
+     *
+     * Called by the polling thread after each change of d_chips or d_insertedChip.
+     */
+    void publishChipSnapshot();
+
+    /**
+     * \brief Poll for cards and fill the chip list, without throwing.
+     * \return The number of chips in the list, or the libnfc error.
+     */
+    NFCResult<size_t> tryRefreshChipList() noexcept;
+
+    /**
+     * \brief Poll for cards as an idle reader, without throwing.
+     * \param wait_until The end of the insertion wait.
+     * \return The number of chips in the list, or the libnfc error.
+     */
+    NFCResult<size_t>
+    tryIdlePoll(std::chrono::steady_clock::time_point wait_until) noexcept;
+
+    /**
+     * \brief Get the target types InAutoPoll polls for some modulations.
+     * \param modulations The poll modulations.
+     * \return The number of target types, each one polled at least 150 ms.
+     */
+    static size_t getAutoPollTypes(const std::vector<nfc_modulation> &modulations);
+
+    /**
+     * \brief Let the reader chip poll by itself, with InAutoPoll.
+     * \param window The longest time to poll for, at least 150 ms per target type.
+     * \return 1 if a card was found, 0 if not, or the libnfc error. NFC_EDEVNOTSUPP
+     * if the reader chip cannot poll by itself.
+     */
+    int autoPoll(std::chrono::milliseconds window);
+
+    /**
+     * \brief Apply the device settings of the configuration, if changed since the
+     * last call.
+     * \return NFC_SUCCESS, or the libnfc error.
+     *
+     * Called before each poll, so that a configuration change needs no reconnection.
+     */
+    int applyConfiguration();
+
+    /**
+     * \brief Reselect a chip.
+     * \param chip The chip.
+     * \return 1 if selected, 0 if not found, or the libnfc error.
+     * \see reselectChip
+     */
+    int reselectChipStatus(std::shared_ptr<Chip> chip);
+
     /**
     * Transmit bit using the NFC reader.
     * This API circumvent all the abstraction provided by reader card adapter and
     * data transport.
     */
-    std::vector<uint8_t> transmitBits(const uint8_t *pbtTx, const size_t szTxBits) const;
+    std::vector<uint8_t> transmitBits(const uint8_t *pbtTx, const size_t szTxBits);
 
+    /**
+     * \brief Get the card type of a target. The caller waited for the prefetch.
+     */
     std::string getCardTypeFromTarget(nfc_target target) const;
 
+    /**
+     * \brief Run the anticollision and SELECT of one tag, after its ATQA.
+     * The caller waited for the prefetch.
+     * \param tag The tag, its UID and SAK are filled.
+     * \return True if the tag was selected.
+     */
+    bool inventorySelect(NFCInventoryTag &tag) const;
+
+    /**
+     * \brief Reuse the inserted chip kept activated by the last disconnect.
+     * \return True if the session is still valid and the chip present.
+     */
+    bool resumeSession();
+
+    /**
+     * \brief Deselect the chip kept activated by the last disconnect, if any.
+     */
+    void releaseSession();
+
+    /**
+     * \brief Send the prefetch script of a chip card type in background.
+     *
+     * Only ISO14443-4 chips are prefetched, the other ones need an authentication
+     * first.
+     * \param chip The chip just inserted.
+     */
+    void startPrefetch(std::shared_ptr<Chip> chip);
+
+    /**
+     * \brief Forget the prefetched responses of the chip the prefetch script was sent
+     * to, the card is not in the state they rely on anymore.
+     */
+    void dropPrefetch();
+
+    /**
+     * \brief Route the commands of a chip through the adapter of a logical target.
+     *
+     * Only done when several targets are activated and no data transport is forced.
+     * The adapters are kept from one activation to the next.
+     * \param chip The chip.
+     * \param target The logical target of the chip, from 0.
+     */
+    void bindTargetAdapter(std::shared_ptr<Chip> chip, size_t target);
+
+    /**
+     * \brief Get the NFC data transport a chip talks through.
+     * \param chip The chip.
+     * \return The data transport, null if the chip has none or shares the one of
+     * another chip.
+     */
+    static std::shared_ptr<NFCDataTransport> getChipDataTransport(std::shared_ptr<Chip> chip);
+
     static std::vector<unsigned char> getCardSerialNumber(nfc_target target);
 
+    /**
+     * \brief Get the frame waiting time an ISO14443-4 card announces in its ATS.
+     * \param nai The card information.
+     * \return The frame waiting time, 0 if the card has no ATS.
+     */
+    static std::chrono::microseconds getFrameWaitingTime(const nfc_iso14443a_info &nai);
+
     /**
      * \brief The reader unit name.
      */
@@ -234,6 +610,113 @@ class LLA_READERS_NFC_NFC_API NFCReaderUnit : public ReaderUnit
      */
     std::map<std::shared_ptr<Chip>, nfc_target> d_chips;
 
+    /**
+     * \brief The last published snapshot of d_chips, only accessed atomically.
+     */
+    std::shared_ptr<const NFCChipSnapshot> d_chip_snapshot;
+
+    /**
+     * \brief The factory of the chips created by this reader unit.
+     */
+    NFCChipFactory d_chip_factory;
+
+    /**
+     * \brief The poll order of the adaptive polling.
+     */
+    NFCPollScheduler d_poll_scheduler;
+
+    /**
+     * \brief The card response times sampled.
+     */
+    NFCResponseTimeProfiler d_response_time_profiler;
+
+    /**
+     * \brief 1 if the reader chip can time the card answers, 0 if not, -1 until
+     * known.
+     */
+    int d_response_timer;
+
+    /**
+     * \brief The chip kept activated after a disconnect, if any.
+     */
+    std::shared_ptr<Chip> d_session_chip;
+
+    /**
+     * \brief When the kept chip was disconnected.
+     */
+    std::chrono::steady_clock::time_point d_session_idle_since;
+
+    /**
+     * \brief The prefetch script running in background, if any.
+     */
+    std::future<NFCPrefetchedResponses> d_prefetch;
+
+    /**
+     * \brief The chip the prefetch script was sent to, still activated.
+     */
+    std::shared_ptr<Chip> d_prefetch_chip;
+
+    /**
+     * \brief The adapters of the logical targets, when several are activated.
+     */
+    std::vector<std::shared_ptr<NFCReaderCardAdapter>> d_target_adapters;
+
+    /**
+     * \brief The smoothed command latency of the reader.
+     */
+    std::chrono::microseconds d_latency;
+
+    /**
+     * \brief The mean deviation of the command latency.
+     */
+    std::chrono::microseconds d_latency_deviation;
+
+    /**
+     * \brief The number of latencies accounted.
+     */
+    size_t d_latency_samples;
+
+    /**
+     * \brief The command timeout multiplier, doubled on each timeout.
+     */
+    unsigned int d_timeout_backoff;
+
+    /**
+     * \brief The configuration applied to the device, and its revision.
+     *
+     * Held weakly: a new configuration allocated where a released one was must
+     * not pass for it.
+     */
+    std::weak_ptr<NFCReaderUnitConfiguration> d_applied_configuration;
+    unsigned int d_applied_revision;
+
+    /**
+     * \brief True if the device is set up for polling and the field is on.
+     */
+    bool d_field_ready;
+
+    /**
+     * \brief True if no card was seen for the idle delay.
+     */
+    bool d_idle;
+
+    /**
+     * \brief Since when no card was seen.
+     */
+    std::chrono::steady_clock::time_point d_quiet_since;
+
+    /**
+     * \brief When the next poll is due.
+     */
+    std::chrono::steady_clock::time_point d_next_poll;
+
+    /**
+     * \brief 1 if the reader chip can poll by itself, 0 if not, -1 until known.
+     */
+    int d_auto_poll;
+
+    NFCPollingStats d_polling_stats;
+
   private:
     /**
      * Call a libnfc function and throw an exception is the return code is non zero.
@@ -265,6 +748,19 @@ class LLA_READERS_NFC_NFC_API NFCReaderUnit : public ReaderUnit
         bool dt_error_flag_;
     };
 
+    /**
+     * Publish the chip snapshot when leaving the scope, whatever the way out, so
+     * the readers never see a stale list once d_chips changed.
+     */
+    struct ChipSnapshotGuard
+    {
+        explicit ChipSnapshotGuard(NFCReaderUnit &ru);
+        ~ChipSnapshotGuard();
+
+      private:
+        NFCReaderUnit &ru_;
+    };
+
     friend class MifareClassicUIDChangerCardService;
 };
 }
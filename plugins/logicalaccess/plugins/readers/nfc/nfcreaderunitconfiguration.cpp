@@ -5,13 +5,119 @@
  */
 
 #include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
 #include <logicalaccess/plugins/readers/nfc/nfcreaderprovider.hpp>
 #include <logicalaccess/plugins/readers/nfc/nfcreaderunitconfiguration.hpp>
+#include <logicalaccess/bufferhelper.hpp>
+#include <logicalaccess/plugins/llacommon/logs.hpp>
 
 namespace logicalaccess
 {
+namespace
+{
+struct modulation_name
+{
+    nfc_modulation_type nmt;
+    const char *name;
+};
+
+const modulation_name modulation_names[] = {
+    {NMT_ISO14443A, "ISO14443A"},       {NMT_JEWEL, "Jewel"},
+    {NMT_ISO14443B, "ISO14443B"},       {NMT_ISO14443BI, "ISO14443BI"},
+    {NMT_ISO14443B2SR, "ISO14443B2SR"}, {NMT_ISO14443B2CT, "ISO14443B2CT"},
+    {NMT_FELICA, "FeliCa"},             {NMT_DEP, "DEP"},
+};
+
+struct baud_rate_kbps
+{
+    nfc_baud_rate nbr;
+    unsigned int kbps;
+};
+
+const baud_rate_kbps baud_rates[] = {
+    {NBR_106, 106}, {NBR_212, 212}, {NBR_424, 424}, {NBR_847, 847},
+};
+
+/**
+ * \brief The NFCReaderUnit.config file of the working directory.
+ */
+struct config_file
+{
+    std::string cardType;
+    boost::optional<boost::property_tree::ptree> configuration;
+};
+
+config_file loadConfigFile()
+{
+    config_file file;
+    file.cardType = "UNKNOWN";
+    try
+    {
+        boost::property_tree::ptree pt;
+        read_xml((boost::filesystem::current_path().string() + "/NFCReaderUnit.config"),
+                 pt);
+        file.cardType = pt.get("config.cardType", "UNKNOWN");
+        boost::optional<boost::property_tree::ptree &> node =
+            pt.get_child_optional("config.NFCReaderUnitConfiguration");
+        if (node)
+        {
+            file.configuration = *node;
+        }
+    }
+    catch (...)
+    {
+    }
+    return file;
+}
+
+const config_file &getConfigFile()
+{
+    static const config_file file = loadConfigFile();
+    return file;
+}
+
+/**
+ * \brief Get a configuration value, the default one if missing or invalid.
+ */
+template <typename T>
+T getValue(const boost::property_tree::ptree &node, const std::string &path,
+           const T &defaultValue)
+{
+    try
+    {
+        return node.get<T>(path, defaultValue);
+    }
+    catch (const boost::property_tree::ptree_error &)
+    {
+        LOG(WARNINGS) << "Invalid " << path << " in the NFC reader configuration, "
+                      << "the default one is used.";
+        return defaultValue;
+    }
+}
+
+/**
+ * \brief Get a configuration enum value, the default one if missing or out of range.
+ */
+template <typename T>
+T getEnumValue(const boost::property_tree::ptree &node, const std::string &path,
+               T defaultValue, T maxValue)
+{
+    int value = getValue<int>(node, path, defaultValue);
+    if (value < 0 || value > maxValue)
+    {
+        LOG(WARNINGS) << "Invalid " << path << " " << value
+                      << " in the NFC reader configuration, the default one is used.";
+        return defaultValue;
+    }
+    return static_cast<T>(value);
+}
+}
+
 NFCReaderUnitConfiguration::NFCReaderUnitConfiguration()
     : ReaderUnitConfiguration(READER_NFC)
+    , d_revision(0)
 {
     NFCReaderUnitConfiguration::resetConfiguration();
 }
@@ -22,20 +128,405 @@ NFCReaderUnitConfiguration::~NFCReaderUnitConfiguration()
 
 void NFCReaderUnitConfiguration::resetConfiguration()
 {
+    const config_file &file = getConfigFile();
+    if (file.configuration)
+    {
+        boost::property_tree::ptree node = *file.configuration;
+        NFCReaderUnitConfiguration::unSerialize(node);
+        return;
+    }
+
+    d_session_idle_timeout = 0;
+    d_prefetch_scripts.clear();
+    d_adaptive_timeout        = false;
+    d_minimum_command_timeout = 20;
+    d_response_time_sampling  = 0;
+    // FIXME NBR_212 should also be polled for FeliCa, see BRP_ALL
+    d_poll_modulations      = {{NMT_ISO14443A, NBR_106}, {NMT_FELICA, NBR_424}};
+    d_adaptive_polling      = false;
+    d_poll_early_exit       = false;
+    d_poll_probe_interval   = 10;
+    d_poll_period           = 50;
+    d_idle_delay            = 0;
+    d_idle_poll_period      = 500;
+    d_idle_low_power        = true;
+    d_field_reset_policy    = FRP_ALWAYS;
+    d_bit_rate_policy       = BRP_CONFIGURED;
+    d_timeout_command       = 350;
+    d_timeout_atr           = 103;
+    d_timeout_communication = 52;
+    ++d_revision;
 }
 
 void NFCReaderUnitConfiguration::serialize(boost::property_tree::ptree &parentNode)
 {
     boost::property_tree::ptree node;
+    node.put("SessionIdleTimeout", d_session_idle_timeout);
+    node.put("AdaptiveTimeout", d_adaptive_timeout);
+    node.put("MinimumCommandTimeout", d_minimum_command_timeout);
+    node.put("ResponseTimeSampling", d_response_time_sampling);
+
+    boost::property_tree::ptree scriptsNode;
+    for (const auto &script : d_prefetch_scripts)
+    {
+        boost::property_tree::ptree scriptNode;
+        scriptNode.put("<xmlattr>.cardType", script.first);
+        for (const std::vector<unsigned char> &command : script.second)
+        {
+            scriptNode.add("Command", BufferHelper::getHex(command));
+        }
+        scriptsNode.add_child("Script", scriptNode);
+    }
+    node.add_child("PrefetchScripts", scriptsNode);
+
+    boost::property_tree::ptree modulationsNode;
+    for (const nfc_modulation &modulation : d_poll_modulations)
+    {
+        boost::property_tree::ptree modulationNode;
+        for (const modulation_name &mn : modulation_names)
+        {
+            if (mn.nmt == modulation.nmt)
+                modulationNode.put("<xmlattr>.type", mn.name);
+        }
+        for (const baud_rate_kbps &br : baud_rates)
+        {
+            if (br.nbr == modulation.nbr)
+                modulationNode.put("<xmlattr>.baudRate", br.kbps);
+        }
+        modulationsNode.add_child("Modulation", modulationNode);
+    }
+    node.add_child("PollModulations", modulationsNode);
+    node.put("AdaptivePolling", d_adaptive_polling);
+    node.put("PollEarlyExit", d_poll_early_exit);
+    node.put("PollProbeInterval", d_poll_probe_interval);
+    node.put("PollPeriod", d_poll_period);
+    node.put("IdleDelay", d_idle_delay);
+    node.put("IdlePollPeriod", d_idle_poll_period);
+    node.put("IdleLowPower", d_idle_low_power);
+    node.put("FieldResetPolicy", static_cast<int>(d_field_reset_policy));
+    node.put("BitRatePolicy", static_cast<int>(d_bit_rate_policy));
+    node.put("TimeoutCommand", d_timeout_command);
+    node.put("TimeoutAtr", d_timeout_atr);
+    node.put("TimeoutCommunication", d_timeout_communication);
     parentNode.add_child(getDefaultXmlNodeName(), node);
 }
 
-void NFCReaderUnitConfiguration::unSerialize(boost::property_tree::ptree & /*node*/)
+void NFCReaderUnitConfiguration::unSerialize(boost::property_tree::ptree &node)
 {
+    // Invalid entries are skipped, the configuration may come from a file
+    d_session_idle_timeout    = getValue<unsigned int>(node, "SessionIdleTimeout", 0);
+    d_adaptive_timeout        = getValue<bool>(node, "AdaptiveTimeout", false);
+    d_minimum_command_timeout = getValue<unsigned int>(node, "MinimumCommandTimeout", 20);
+    d_response_time_sampling  = getValue<unsigned int>(node, "ResponseTimeSampling", 0);
+
+    d_prefetch_scripts.clear();
+    boost::optional<boost::property_tree::ptree &> scriptsNode =
+        node.get_child_optional("PrefetchScripts");
+    if (scriptsNode)
+    {
+        for (const auto &scriptNode : *scriptsNode)
+        {
+            if (scriptNode.first != "Script")
+                continue;
+
+            boost::optional<std::string> cardType =
+                scriptNode.second.get_optional<std::string>("<xmlattr>.cardType");
+            if (!cardType)
+            {
+                LOG(WARNINGS) << "Prefetch script without card type, skipped.";
+                continue;
+            }
+            std::vector<std::vector<unsigned char>> commands;
+            for (const auto &commandNode : scriptNode.second)
+            {
+                if (commandNode.first == "Command")
+                {
+                    commands.push_back(
+                        BufferHelper::fromHexString(commandNode.second.data()));
+                }
+            }
+            setPrefetchScript(*cardType, commands);
+        }
+    }
+
+    d_poll_modulations = {{NMT_ISO14443A, NBR_106}, {NMT_FELICA, NBR_424}};
+    boost::optional<boost::property_tree::ptree &> modulationsNode =
+        node.get_child_optional("PollModulations");
+    if (modulationsNode)
+    {
+        d_poll_modulations.clear();
+        for (const auto &modulationNode : *modulationsNode)
+        {
+            if (modulationNode.first != "Modulation")
+                continue;
+
+            std::string type =
+                getValue<std::string>(modulationNode.second, "<xmlattr>.type", "");
+            unsigned int kbps =
+                getValue<unsigned int>(modulationNode.second, "<xmlattr>.baudRate", 106);
+            nfc_modulation modulation = {static_cast<nfc_modulation_type>(0),
+                                         NBR_UNDEFINED};
+            for (const modulation_name &mn : modulation_names)
+            {
+                if (type == mn.name)
+                    modulation.nmt = mn.nmt;
+            }
+            for (const baud_rate_kbps &br : baud_rates)
+            {
+                if (kbps == br.kbps)
+                    modulation.nbr = br.nbr;
+            }
+            if (modulation.nmt == 0 || modulation.nbr == NBR_UNDEFINED)
+            {
+                LOG(WARNINGS) << "Unsupported poll modulation \"" << type << "\" at "
+                              << kbps << " kbps, skipped.";
+                continue;
+            }
+            d_poll_modulations.push_back(modulation);
+        }
+    }
+    d_adaptive_polling    = getValue<bool>(node, "AdaptivePolling", false);
+    d_poll_early_exit     = getValue<bool>(node, "PollEarlyExit", false);
+    d_poll_probe_interval = getValue<unsigned int>(node, "PollProbeInterval", 10);
+    d_poll_period         = getValue<unsigned int>(node, "PollPeriod", 50);
+    d_idle_delay          = getValue<unsigned int>(node, "IdleDelay", 0);
+    d_idle_poll_period    = getValue<unsigned int>(node, "IdlePollPeriod", 500);
+    d_idle_low_power      = getValue<bool>(node, "IdleLowPower", true);
+    d_field_reset_policy =
+        getEnumValue<NFCFieldResetPolicy>(node, "FieldResetPolicy", FRP_ALWAYS, FRP_NEVER);
+    d_bit_rate_policy =
+        getEnumValue<NFCBitRatePolicy>(node, "BitRatePolicy", BRP_CONFIGURED, BRP_ALL);
+    d_timeout_command       = getValue<int>(node, "TimeoutCommand", 350);
+    d_timeout_atr           = getValue<int>(node, "TimeoutAtr", 103);
+    d_timeout_communication = getValue<int>(node, "TimeoutCommunication", 52);
+    ++d_revision;
 }
 
 std::string NFCReaderUnitConfiguration::getDefaultXmlNodeName() const
 {
     return "NFCReaderUnitConfiguration";
 }
+
+std::string NFCReaderUnitConfiguration::getDefaultCardType()
+{
+    return getConfigFile().cardType;
+}
+
+unsigned int NFCReaderUnitConfiguration::getRevision() const
+{
+    return d_revision;
+}
+
+unsigned int NFCReaderUnitConfiguration::getSessionIdleTimeout() const
+{
+    return d_session_idle_timeout;
+}
+
+void NFCReaderUnitConfiguration::setSessionIdleTimeout(unsigned int timeout)
+{
+    d_session_idle_timeout = timeout;
+    ++d_revision;
+}
+
+std::vector<std::vector<unsigned char>>
+NFCReaderUnitConfiguration::getPrefetchScript(const std::string &cardType) const
+{
+    auto it = d_prefetch_scripts.find(cardType);
+    if (it == d_prefetch_scripts.end())
+    {
+        return {};
+    }
+    return it->second;
+}
+
+void NFCReaderUnitConfiguration::setPrefetchScript(
+    const std::string &cardType, const std::vector<std::vector<unsigned char>> &commands)
+{
+    if (commands.empty())
+    {
+        d_prefetch_scripts.erase(cardType);
+    }
+    else
+    {
+        d_prefetch_scripts[cardType] = commands;
+    }
+    ++d_revision;
+}
+
+bool NFCReaderUnitConfiguration::getAdaptiveTimeout() const
+{
+    return d_adaptive_timeout;
+}
+
+void NFCReaderUnitConfiguration::setAdaptiveTimeout(bool adaptive)
+{
+    d_adaptive_timeout = adaptive;
+    ++d_revision;
+}
+
+unsigned int NFCReaderUnitConfiguration::getMinimumCommandTimeout() const
+{
+    return d_minimum_command_timeout;
+}
+
+void NFCReaderUnitConfiguration::setMinimumCommandTimeout(unsigned int timeout)
+{
+    d_minimum_command_timeout = timeout;
+    ++d_revision;
+}
+
+unsigned int NFCReaderUnitConfiguration::getResponseTimeSampling() const
+{
+    return d_response_time_sampling;
+}
+
+void NFCReaderUnitConfiguration::setResponseTimeSampling(unsigned int interval)
+{
+    d_response_time_sampling = interval;
+    ++d_revision;
+}
+
+std::vector<nfc_modulation> NFCReaderUnitConfiguration::getPollModulations() const
+{
+    return d_poll_modulations;
+}
+
+void NFCReaderUnitConfiguration::setPollModulations(
+    const std::vector<nfc_modulation> &modulations)
+{
+    d_poll_modulations = modulations;
+    ++d_revision;
+}
+
+bool NFCReaderUnitConfiguration::getAdaptivePolling() const
+{
+    return d_adaptive_polling;
+}
+
+void NFCReaderUnitConfiguration::setAdaptivePolling(bool adaptive)
+{
+    d_adaptive_polling = adaptive;
+    ++d_revision;
+}
+
+bool NFCReaderUnitConfiguration::getPollEarlyExit() const
+{
+    return d_poll_early_exit;
+}
+
+void NFCReaderUnitConfiguration::setPollEarlyExit(bool earlyExit)
+{
+    d_poll_early_exit = earlyExit;
+    ++d_revision;
+}
+
+unsigned int NFCReaderUnitConfiguration::getPollProbeInterval() const
+{
+    return d_poll_probe_interval;
+}
+
+void NFCReaderUnitConfiguration::setPollProbeInterval(unsigned int interval)
+{
+    d_poll_probe_interval = interval;
+    ++d_revision;
+}
+
+unsigned int NFCReaderUnitConfiguration::getPollPeriod() const
+{
+    return d_poll_period;
+}
+
+void NFCReaderUnitConfiguration::setPollPeriod(unsigned int period)
+{
+    d_poll_period = period;
+    ++d_revision;
+}
+
+unsigned int NFCReaderUnitConfiguration::getIdleDelay() const
+{
+    return d_idle_delay;
+}
+
+void NFCReaderUnitConfiguration::setIdleDelay(unsigned int delay)
+{
+    d_idle_delay = delay;
+    ++d_revision;
+}
+
+unsigned int NFCReaderUnitConfiguration::getIdlePollPeriod() const
+{
+    return d_idle_poll_period;
+}
+
+void NFCReaderUnitConfiguration::setIdlePollPeriod(unsigned int period)
+{
+    d_idle_poll_period = period;
+    ++d_revision;
+}
+
+bool NFCReaderUnitConfiguration::getIdleLowPower() const
+{
+    return d_idle_low_power;
+}
+
+void NFCReaderUnitConfiguration::setIdleLowPower(bool lowPower)
+{
+    d_idle_low_power = lowPower;
+    ++d_revision;
+}
+
+NFCFieldResetPolicy NFCReaderUnitConfiguration::getFieldResetPolicy() const
+{
+    return d_field_reset_policy;
+}
+
+void NFCReaderUnitConfiguration::setFieldResetPolicy(NFCFieldResetPolicy policy)
+{
+    d_field_reset_policy = policy;
+    ++d_revision;
+}
+
+NFCBitRatePolicy NFCReaderUnitConfiguration::getBitRatePolicy() const
+{
+    return d_bit_rate_policy;
+}
+
+void NFCReaderUnitConfiguration::setBitRatePolicy(NFCBitRatePolicy policy)
+{
+    d_bit_rate_policy = policy;
+    ++d_revision;
+}
+
+int NFCReaderUnitConfiguration::getTimeoutCommand() const
+{
+    return d_timeout_command;
+}
+
+void NFCReaderUnitConfiguration::setTimeoutCommand(int timeout)
+{
+    d_timeout_command = timeout;
+    ++d_revision;
+}
+
+int NFCReaderUnitConfiguration::getTimeoutAtr() const
+{
+    return d_timeout_atr;
+}
+
+void NFCReaderUnitConfiguration::setTimeoutAtr(int timeout)
+{
+    d_timeout_atr = timeout;
+    ++d_revision;
+}
+
+int NFCReaderUnitConfiguration::getTimeoutCommunication() const
+{
+    return d_timeout_communication;
+}
+
+void NFCReaderUnitConfiguration::setTimeoutCommunication(int timeout)
+{
+    d_timeout_communication = timeout;
+    ++d_revision;
+}
 }
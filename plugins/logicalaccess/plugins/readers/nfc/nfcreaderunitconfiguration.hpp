@@ -9,9 +9,30 @@
 
 #include <logicalaccess/readerproviders/readerunitconfiguration.hpp>
 #include <logicalaccess/plugins/readers/nfc/lla_readers_nfc_nfc_api.hpp>
+#include <nfc/nfc-types.h>
+#include <atomic>
+#include <map>
+#include <vector>
 
 namespace logicalaccess
 {
+/**
+ * \brief When the RF field is dropped before polling for cards.
+ */
+typedef enum {
+    FRP_ALWAYS = 0x00, /**< Before each poll, so halted cards answer again */
+    FRP_NEVER  = 0x01  /**< Only on the first poll, a card already read stays silent */
+} NFCFieldResetPolicy;
+
+/**
+ * \brief Which bit rates a modulation is polled at.
+ */
+typedef enum {
+    BRP_CONFIGURED = 0x00, /**< The bit rate of the poll modulation */
+    BRP_HIGHEST    = 0x01, /**< The highest bit rate the reader supports */
+    BRP_ALL        = 0x02  /**< Every bit rate the reader supports, highest first */
+} NFCBitRatePolicy;
+
 /**
  * \brief The NFC reader unit configuration base class.
  */
@@ -42,6 +63,8 @@ class LLA_READERS_NFC_NFC_API NFCReaderUnitConfiguration : public ReaderUnitConf
     /**
      * \brief UnSerialize a XML node to the current object.
      * \param node The XML node.
+     *
+     * Missing or invalid entries are logged and get their default value.
      */
     void unSerialize(boost::property_tree::ptree &node) override;
 
@@ -50,6 +73,376 @@ class LLA_READERS_NFC_NFC_API NFCReaderUnitConfiguration : public ReaderUnitConf
      * \return The Xml node name.
      */
     std::string getDefaultXmlNodeName() const override;
+
+    /**
+     * \brief Get the card type set in the NFCReaderUnit.config file.
+     * \return The card type, "UNKNOWN" if none.
+     *
+     * The file, in the working directory, is parsed once per process. Its
+     * config.NFCReaderUnitConfiguration node, if any, gives the values
+     * resetConfiguration() restores.
+     */
+    static std::string getDefaultCardType();
+
+    /**
+     * \brief Get the revision of the configuration.
+     * \return A number changing with every setting change.
+     *
+     * The reader unit applies the device settings again when it changes.
+     */
+    unsigned int getRevision() const;
+
+    /**
+     * \brief Get the session idle timeout.
+     * \return The session idle timeout, in milliseconds. 0 if sessions are not kept.
+     */
+    unsigned int getSessionIdleTimeout() const;
+
+    /**
+     * \brief Set the session idle timeout.
+     * \param timeout The session idle timeout, in milliseconds. 0 to disable.
+     *
+     * When enabled, disconnecting from an ISO14443-4 card keeps it activated
+     * for this time. A connection within the window only checks the card is
+     * still present, instead of deselecting and activating it again.
+     */
+    void setSessionIdleTimeout(unsigned int timeout);
+
+    /**
+     * \brief Get the commands sent ahead to a card type after its insertion.
+     * \param cardType The card type.
+     * \return The commands, empty if the card type has no prefetch script.
+     */
+    std::vector<std::vector<unsigned char>>
+    getPrefetchScript(const std::string &cardType) const;
+
+    /**
+     * \brief Set the commands sent ahead to a card type after its insertion.
+     * \param cardType The card type.
+     * \param commands The commands, as sent to the card. Empty to disable.
+     *
+     * The commands are sent in background as soon as the card is detected. As
+     * long as the application sends the same commands in the same order, they
+     * are answered with the prefetched responses. Only commands whose effect is
+     * overridden by later ones (reads, selections) should be prefetched. Only
+     * ISO14443-4 cards are prefetched, the other ones need an authentication
+     * first.
+     */
+    void setPrefetchScript(const std::string &cardType,
+                           const std::vector<std::vector<unsigned char>> &commands);
+
+    /**
+     * \brief Get if command timeouts adapt to the card and the reader.
+     * \return True if adaptive timeouts are enabled.
+     */
+    bool getAdaptiveTimeout() const;
+
+    /**
+     * \brief Set if command timeouts adapt to the card and the reader.
+     * \param adaptive True to enable adaptive timeouts.
+     *
+     * When enabled, a command gets the card frame waiting time plus the
+     * latency observed on the reader, instead of the whole timeout given by
+     * the caller. The caller timeout stays the upper bound. Disabled by default:
+     * the reader grants the waiting time extensions a card asks for without
+     * telling the host, so a command the card extends more than once (DESFire
+     * FormatPICC or CommitTransaction, large writes) can time out.
+     */
+    void setAdaptiveTimeout(bool adaptive);
+
+    /**
+     * \brief Get the lowest timeout given to a command.
+     * \return The minimum command timeout, in milliseconds.
+     */
+    unsigned int getMinimumCommandTimeout() const;
+
+    /**
+     * \brief Set the lowest timeout given to a command.
+     * \param timeout The minimum command timeout, in milliseconds.
+     */
+    void setMinimumCommandTimeout(unsigned int timeout);
+
+    /**
+     * \brief Get how often the card response time of an exchange is sampled.
+     * \return The sampling interval, 0 if disabled.
+     */
+    unsigned int getResponseTimeSampling() const;
+
+    /**
+     * \brief Set how often the card response time of an exchange is sampled.
+     * \param interval One exchange out of interval is timed, 0 to disable.
+     *
+     * Timing an exchange reads the timer of the reader chip right after it:
+     * one more reader command. See NFCReaderUnit::getResponseTimeStatistics().
+     */
+    void setResponseTimeSampling(unsigned int interval);
+
+    /**
+     * \brief Get the modulations polled for cards.
+     * \return The modulations, in polling order.
+     */
+    std::vector<nfc_modulation> getPollModulations() const;
+
+    /**
+     * \brief Set the modulations polled for cards.
+     * \param modulations The modulations, in polling order.
+     *
+     * Cards found first are first in the chip list, removing a modulation makes
+     * each poll shorter.
+     */
+    void setPollModulations(const std::vector<nfc_modulation> &modulations);
+
+    /**
+     * \brief Get if the poll order adapts to the cards seen by the reader.
+     * \return True if adaptive polling is enabled.
+     */
+    bool getAdaptivePolling() const;
+
+    /**
+     * \brief Set if the poll order adapts to the cards seen by the reader.
+     * \param adaptive True to enable adaptive polling.
+     *
+     * When enabled, the poll modulations are the candidates of a NFCPollScheduler:
+     * the ones that detect most cards for the time they take are polled first
+     * and rare ones are only probed from time to time.
+     */
+    void setAdaptivePolling(bool adaptive);
+
+    /**
+     * \brief Get if a poll stops at the first modulation that finds cards.
+     * \return True if early exit is enabled.
+     */
+    bool getPollEarlyExit() const;
+
+    /**
+     * \brief Set if a poll stops at the first modulation that finds cards.
+     * \param earlyExit True to enable early exit.
+     *
+     * Disabled by default. When enabled, a poll is shorter as soon as a card is
+     * in the field, but cards of the modulations left are not seen as long as it
+     * stays there.
+     */
+    void setPollEarlyExit(bool earlyExit);
+
+    /**
+     * \brief Get the poll cycles between two probes of a rare modulation.
+     * \return The probe interval, in poll cycles.
+     */
+    unsigned int getPollProbeInterval() const;
+
+    /**
+     * \brief Set the poll cycles between two probes of a rare modulation.
+     * \param interval The probe interval, in poll cycles. 0 never skips any
+     * modulation.
+     *
+     * A card of a rare modulation is detected after this many polls at worst.
+     */
+    void setPollProbeInterval(unsigned int interval);
+
+    /**
+     * \brief Get the time between two polls.
+     * \return The poll period, in milliseconds.
+     */
+    unsigned int getPollPeriod() const;
+
+    /**
+     * \brief Set the time between two polls.
+     * \param period The poll period, in milliseconds.
+     */
+    void setPollPeriod(unsigned int period);
+
+    /**
+     * \brief Get the time without card after which the reader goes idle.
+     * \return The idle delay, in milliseconds. 0 if the reader never goes idle.
+     */
+    unsigned int getIdleDelay() const;
+
+    /**
+     * \brief Set the time without card after which the reader goes idle.
+     * \param delay The idle delay, in milliseconds. 0 to disable the idle mode.
+     *
+     * An idle reader is polled every idle poll period instead of every poll
+     * period, and goes back to the poll period on the first card detected.
+     */
+    void setIdleDelay(unsigned int delay);
+
+    /**
+     * \brief Get the time between two polls of an idle reader.
+     * \return The idle poll period, in milliseconds.
+     */
+    unsigned int getIdlePollPeriod() const;
+
+    /**
+     * \brief Set the time between two polls of an idle reader.
+     * \param period The idle poll period, in milliseconds.
+     */
+    void setIdlePollPeriod(unsigned int period);
+
+    /**
+     * \brief Get if an idle reader uses the chip low power modes.
+     * \return True if the low power modes are used.
+     */
+    bool getIdleLowPower() const;
+
+    /**
+     * \brief Set if an idle reader uses the chip low power modes.
+     * \param lowPower True to use the low power modes.
+     *
+     * When enabled, an idle reader drops the field between two polls, and
+     * libnfc powers a PN532 down when its driver allows it. A PN532 polls by
+     * itself (InAutoPoll) during the idle poll period, so a card is detected
+     * without waiting for the next poll.
+     */
+    void setIdleLowPower(bool lowPower);
+
+    /**
+     * \brief Get when the RF field is dropped before polling.
+     * \return The field reset policy.
+     */
+    NFCFieldResetPolicy getFieldResetPolicy() const;
+
+    /**
+     * \brief Set when the RF field is dropped before polling.
+     * \param policy The field reset policy.
+     */
+    void setFieldResetPolicy(NFCFieldResetPolicy policy);
+
+    /**
+     * \brief Get which bit rates the modulations are polled at.
+     * \return The bit rate policy.
+     */
+    NFCBitRatePolicy getBitRatePolicy() const;
+
+    /**
+     * \brief Set which bit rates the modulations are polled at.
+     * \param policy The bit rate policy.
+     */
+    void setBitRatePolicy(NFCBitRatePolicy policy);
+
+    /**
+     * \brief Get the default timeout of a reader command (NP_TIMEOUT_COMMAND).
+     * \return The timeout, in milliseconds.
+     */
+    int getTimeoutCommand() const;
+
+    /**
+     * \brief Set the default timeout of a reader command (NP_TIMEOUT_COMMAND).
+     * \param timeout The timeout, in milliseconds.
+     */
+    void setTimeoutCommand(int timeout);
+
+    /**
+     * \brief Get the timeout of the card activation (NP_TIMEOUT_ATR).
+     * \return The timeout, in milliseconds.
+     */
+    int getTimeoutAtr() const;
+
+    /**
+     * \brief Set the timeout of the card activation (NP_TIMEOUT_ATR).
+     * \param timeout The timeout, in milliseconds.
+     */
+    void setTimeoutAtr(int timeout);
+
+    /**
+     * \brief Get the timeout of a card response (NP_TIMEOUT_COM).
+     * \return The timeout, in milliseconds.
+     */
+    int getTimeoutCommunication() const;
+
+    /**
+     * \brief Set the timeout of a card response (NP_TIMEOUT_COM).
+     * \param timeout The timeout, in milliseconds.
+     */
+    void setTimeoutCommunication(int timeout);
+
+  protected:
+    /**
+     * \brief The session idle timeout, in milliseconds.
+     */
+    unsigned int d_session_idle_timeout;
+
+    /**
+     * \brief The prefetch scripts, by card type.
+     */
+    std::map<std::string, std::vector<std::vector<unsigned char>>> d_prefetch_scripts;
+
+    /**
+     * \brief True if command timeouts adapt to the card and the reader.
+     */
+    bool d_adaptive_timeout;
+
+    /**
+     * \brief The lowest timeout given to a command, in milliseconds.
+     */
+    unsigned int d_minimum_command_timeout;
+
+    /**
+     * \brief One exchange out of this many is timed, 0 for none.
+     */
+    unsigned int d_response_time_sampling;
+
+    /**
+     * \brief The modulations polled for cards, in order.
+     */
+    std::vector<nfc_modulation> d_poll_modulations;
+
+    /**
+     * \brief True if the poll order adapts to the cards seen by the reader.
+     */
+    bool d_adaptive_polling;
+
+    /**
+     * \brief True if a poll stops at the first modulation that finds cards.
+     */
+    bool d_poll_early_exit;
+
+    /**
+     * \brief The poll cycles between two probes of a rare modulation.
+     */
+    unsigned int d_poll_probe_interval;
+
+    /**
+     * \brief The time between two polls, in milliseconds.
+     */
+    unsigned int d_poll_period;
+
+    /**
+     * \brief The time without card after which the reader goes idle, in
+     * milliseconds.
+     */
+    unsigned int d_idle_delay;
+
+    /**
+     * \brief The time between two polls of an idle reader, in milliseconds.
+     */
+    unsigned int d_idle_poll_period;
+
+    /**
+     * \brief True if an idle reader uses the chip low power modes.
+     */
+    bool d_idle_low_power;
+
+    /**
+     * \brief When the RF field is dropped before polling.
+     */
+    NFCFieldResetPolicy d_field_reset_policy;
+
+    /**
+     * \brief Which bit rates the modulations are polled at.
+     */
+    NFCBitRatePolicy d_bit_rate_policy;
+
+    /**
+     * \brief The reader timeouts, in milliseconds.
+     */
+    int d_timeout_command;
+    int d_timeout_atr;
+    int d_timeout_communication;
+
+    /**
+     * \brief The configuration revision, read by the polling thread.
+     */
+    std::atomic<unsigned int> d_revision;
 };
 }
 
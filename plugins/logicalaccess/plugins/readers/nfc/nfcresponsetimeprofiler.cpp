@@ -0,0 +1,137 @@
+/**
+ * \file nfcresponsetimeprofiler.cpp
+ * \brief NFC card response time profiler.
+ */
+
+#include <logicalaccess/plugins/readers/nfc/nfcresponsetimeprofiler.hpp>
+
+#include <algorithm>
+
+namespace logicalaccess
+{
+/**
+ * \brief The carrier frequency, in kHz.
+ */
+#define NFC_CARRIER_KHZ 13560
+
+NFCDurationHistogram::NFCDurationHistogram()
+    : count(0)
+    , total(0)
+    , min(0)
+    , max(0)
+{
+    buckets.fill(0);
+}
+
+void NFCDurationHistogram::add(std::chrono::microseconds duration)
+{
+    size_t bucket = 0;
+    while (bucket + 1 < buckets.size() && duration.count() >= (1LL << bucket))
+    {
+        ++bucket;
+    }
+    ++buckets[bucket];
+
+    if (count++ == 0)
+    {
+        min = duration;
+        max = duration;
+    }
+    else
+    {
+        min = std::min(min, duration);
+        max = std::max(max, duration);
+    }
+    total += duration;
+}
+
+std::chrono::microseconds NFCDurationHistogram::mean() const
+{
+    return count > 0 ? total / static_cast<std::chrono::microseconds::rep>(count)
+                     : std::chrono::microseconds(0);
+}
+
+std::chrono::microseconds NFCDurationHistogram::percentile(unsigned int percent) const
+{
+    size_t counted = 0;
+    for (size_t n = 0; n < buckets.size(); ++n)
+    {
+        counted += buckets[n];
+        if (counted > 0 && counted * 100 >= count * percent)
+        {
+            return std::min(std::chrono::microseconds(1LL << n), max);
+        }
+    }
+    return max;
+}
+
+NFCResponseTimeProfiler::NFCResponseTimeProfiler()
+    : d_unsampled(0)
+{
+}
+
+bool NFCResponseTimeProfiler::sample(unsigned int interval)
+{
+    if (interval == 0)
+    {
+        return false;
+    }
+    if (++d_unsampled < interval)
+    {
+        return false;
+    }
+    d_unsampled = 0;
+    return true;
+}
+
+void NFCResponseTimeProfiler::record(const std::string &cardType, uint32_t cycles,
+                                     std::chrono::microseconds exchange,
+                                     std::chrono::microseconds bus)
+{
+    auto it = d_statistics.find(cardType);
+    if (it == d_statistics.end())
+    {
+        NFCResponseTimeStatistics statistics = NFCResponseTimeStatistics();
+        it = d_statistics.insert(std::make_pair(cardType, statistics)).first;
+    }
+    NFCResponseTimeStatistics &statistics = it->second;
+
+    ++statistics.samples;
+    statistics.bus.add(bus);
+    if (cycles == 0xFFFFFFFF)
+    {
+        ++statistics.unanswered;
+        return;
+    }
+
+    if (statistics.card.count == 0)
+    {
+        statistics.minCycles = cycles;
+        statistics.maxCycles = cycles;
+    }
+    else
+    {
+        statistics.minCycles = std::min(statistics.minCycles, cycles);
+        statistics.maxCycles = std::max(statistics.maxCycles, cycles);
+    }
+    statistics.totalCycles += cycles;
+
+    std::chrono::microseconds card = cyclesToDuration(cycles);
+    statistics.card.add(card);
+    // The exchange holds one bus round trip, like the timer read
+    statistics.reader.add(
+        std::max(exchange - card - bus, std::chrono::microseconds(0)));
+}
+
+void NFCResponseTimeProfiler::reset()
+{
+    d_statistics.clear();
+    d_unsampled = 0;
+}
+
+std::chrono::microseconds NFCResponseTimeProfiler::cyclesToDuration(uint32_t cycles)
+{
+    return std::chrono::microseconds(
+        (static_cast<long long>(cycles) * 1000 + NFC_CARRIER_KHZ / 2) / NFC_CARRIER_KHZ);
+}
+}
@@ -0,0 +1,157 @@
+/**
+ * \file nfcresponsetimeprofiler.hpp
+ * \brief NFC card response time profiler.
+ */
+
+#ifndef LOGICALACCESS_NFCRESPONSETIMEPROFILER_HPP
+#define LOGICALACCESS_NFCRESPONSETIMEPROFILER_HPP
+
+#include <logicalaccess/plugins/readers/nfc/lla_readers_nfc_nfc_api.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace logicalaccess
+{
+/**
+ * \brief The buckets of a duration histogram.
+ */
+#define NFC_DURATION_HISTOGRAM_BUCKETS 24
+
+/**
+ * \brief A distribution of durations.
+ *
+ * Bucket n counts the durations below 2^n microseconds and not below the
+ * previous bucket, the last bucket counts all the longer ones.
+ */
+struct LLA_READERS_NFC_NFC_API NFCDurationHistogram
+{
+    std::array<size_t, NFC_DURATION_HISTOGRAM_BUCKETS> buckets;
+    size_t count;
+    std::chrono::microseconds total;
+    std::chrono::microseconds min;
+    std::chrono::microseconds max;
+
+    /**
+     * \brief Constructor, for an empty distribution.
+     */
+    NFCDurationHistogram();
+
+    /**
+     * \brief Account a duration.
+     * \param duration The duration.
+     */
+    void add(std::chrono::microseconds duration);
+
+    /**
+     * \brief Get the mean duration.
+     * \return The mean, 0 if empty.
+     */
+    std::chrono::microseconds mean() const;
+
+    /**
+     * \brief Get a percentile of the durations.
+     * \param percent The percentile, 0 to 100.
+     * \return The upper bound of the bucket reaching the percentile, never above
+     * the longest duration. 0 if empty.
+     */
+    std::chrono::microseconds percentile(unsigned int percent) const;
+};
+
+/**
+ * \brief What the profiler observed of the exchanges with a card type.
+ *
+ * A sampled exchange is split in three: the card time, between the end of the
+ * last frame sent and the start of the answer, as timed by the reader chip; the
+ * bus time, the round trip of a reader command from the host; the reader time,
+ * all the rest, i.e. the frames on air and the reader firmware.
+ */
+struct NFCResponseTimeStatistics
+{
+    /**
+     * \brief The exchanges sampled.
+     */
+    size_t samples;
+    /**
+     * \brief The sampled exchanges the card did not answer before the reader
+     * timeout. They are only accounted in the bus time.
+     */
+    size_t unanswered;
+    /**
+     * \brief The card times, in carrier cycles.
+     */
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    unsigned long long totalCycles;
+    NFCDurationHistogram card;
+    NFCDurationHistogram reader;
+    NFCDurationHistogram bus;
+};
+
+/**
+ * \brief Samples the card response times of a reader unit, per card type.
+ *
+ * Timing an exchange costs a reader command, so only one exchange out of the
+ * sampling interval is timed.
+ */
+class LLA_READERS_NFC_NFC_API NFCResponseTimeProfiler
+{
+  public:
+    /**
+     * \brief Constructor.
+     */
+    NFCResponseTimeProfiler();
+
+    /**
+     * \brief Tell if the exchange just done is sampled.
+     * \param interval One exchange out of interval is sampled, 0 for none.
+     * \return True if the exchange is to be timed.
+     */
+    bool sample(unsigned int interval);
+
+    /**
+     * \brief Account a sampled exchange.
+     * \param cardType The card type.
+     * \param cycles The card time in carrier cycles, 0xFFFFFFFF if the card did
+     * not answer before the reader timeout.
+     * \param exchange The time the exchange took.
+     * \param bus The time reading the reader timer took.
+     */
+    void record(const std::string &cardType, uint32_t cycles,
+                std::chrono::microseconds exchange, std::chrono::microseconds bus);
+
+    /**
+     * \brief Forget what was observed.
+     */
+    void reset();
+
+    /**
+     * \brief Get the statistics of each card type.
+     * \return The statistics, by card type.
+     */
+    const std::map<std::string, NFCResponseTimeStatistics> &getStatistics() const
+    {
+        return d_statistics;
+    }
+
+    /**
+     * \brief Convert carrier cycles to a duration.
+     * \param cycles The cycles of the 13.56 MHz carrier.
+     * \return The duration, rounded to the nearest microsecond.
+     */
+    static std::chrono::microseconds cyclesToDuration(uint32_t cycles);
+
+  protected:
+    std::map<std::string, NFCResponseTimeStatistics> d_statistics;
+
+    /**
+     * \brief The exchanges since the last sample.
+     */
+    unsigned int d_unsampled;
+};
+}
+
+#endif /* LOGICALACCESS_NFCRESPONSETIMEPROFILER_HPP */
@@ -0,0 +1,66 @@
+/**
+ * \file nfcresult.cpp
+ * \brief Result of a non-throwing NFC operation.
+ */
+
+#include <logicalaccess/plugins/readers/nfc/nfcresult.hpp>
+#include <logicalaccess/plugins/llacommon/logs.hpp>
+#include <logicalaccess/myexception.hpp>
+
+namespace logicalaccess
+{
+std::string getNFCErrorMessage(int error)
+{
+    std::string msg = "NFC error : " + std::to_string(error) + ". ";
+
+    switch (error)
+    {
+    case NFC_EIO:
+        msg += std::string("Input / output error, device may not be usable anymore "
+                           "without re-open it.");
+        break;
+    case NFC_EINVARG: msg += std::string("Invalid argument(s)."); break;
+    case NFC_EDEVNOTSUPP:
+        msg += std::string("Operation not supported by device.");
+        break;
+    case NFC_ENOTSUCHDEV: msg += std::string("No such device."); break;
+    case NFC_EOVFLOW: msg += std::string("Buffer overflow."); break;
+    case NFC_ETIMEOUT: msg += std::string("Operation timed out."); break;
+    case NFC_EOPABORTED: msg += std::string("Operation aborted (by user)."); break;
+    case NFC_ENOTIMPL: msg += std::string("Not (yet) implemented."); break;
+    case NFC_ETGRELEASED: msg += std::string("Target released."); break;
+    case NFC_ERFTRANS: msg += std::string("Error while RF transmission."); break;
+    case NFC_EMFCAUTHFAIL:
+        msg += std::string("MIFARE Classic: authentication failed.");
+        break;
+    case NFC_ESOFT:
+        msg += std::string("Software error (allocation, file/pipe creation, etc.).");
+        break;
+    case NFC_ECHIP: msg += std::string("Device's internal chip error."); break;
+    default:;
+    }
+
+    return msg;
+}
+
+void throwNFCError(int error)
+{
+    THROW_EXCEPTION_WITH_LOG(CardException, getNFCErrorMessage(error));
+}
+
+std::string getExceptionMessage(std::exception_ptr exception)
+{
+    try
+    {
+        std::rethrow_exception(exception);
+    }
+    catch (const std::exception &ex)
+    {
+        return ex.what();
+    }
+    catch (...)
+    {
+        return getNFCErrorMessage(NFC_ESOFT);
+    }
+}
+}
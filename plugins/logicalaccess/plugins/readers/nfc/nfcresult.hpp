@@ -0,0 +1,163 @@
+/**
+ * \file nfcresult.hpp
+ * \brief Result of a non-throwing NFC operation.
+ */
+
+#ifndef LOGICALACCESS_NFCRESULT_HPP
+#define LOGICALACCESS_NFCRESULT_HPP
+
+#include <logicalaccess/plugins/readers/nfc/lla_readers_nfc_nfc_api.hpp>
+#include <nfc/nfc.h>
+
+#include <exception>
+#include <string>
+#include <utility>
+
+namespace logicalaccess
+{
+/**
+ * \brief Get the message describing a libnfc error.
+ * \param error The libnfc error code.
+ * \return The error message.
+ */
+LLA_READERS_NFC_NFC_API std::string getNFCErrorMessage(int error);
+
+/**
+ * \brief Throw the CardException of a libnfc error.
+ * \param error The libnfc error code.
+ */
+LLA_READERS_NFC_NFC_API void throwNFCError(int error);
+
+/**
+ * \brief Get the message of a caught exception.
+ * \param exception The exception.
+ * \return Its what(), or the NFC_ESOFT message if it is not a std::exception.
+ */
+LLA_READERS_NFC_NFC_API std::string getExceptionMessage(std::exception_ptr exception);
+
+/**
+ * \brief A value, or the libnfc error that prevented to get it.
+ *
+ * Returned by the non-throwing variants of the polling, connection and transceive
+ * operations, where timeouts and RF errors are expected. The error message is only
+ * built when message() or value() surfaces it. An exception thrown by the operation
+ * is kept as is, with NFC_ESOFT as error code, for the throwing API to rethrow.
+ */
+template <typename T>
+class NFCResult
+{
+  public:
+    /**
+     * \brief Constructor of a successful result.
+     * \param value The value.
+     */
+    NFCResult(T value)
+        : d_value(std::move(value))
+        , d_error(NFC_SUCCESS)
+    {
+    }
+
+    /**
+     * \brief Create a failed result.
+     * \param error The libnfc error code.
+     * \return The result.
+     */
+    static NFCResult failure(int error)
+    {
+        NFCResult result{T()};
+        result.d_error = error;
+        return result;
+    }
+
+    /**
+     * \brief Create a result failed by an exception.
+     * \param exception The exception thrown by the operation.
+     * \return The result.
+     */
+    static NFCResult failure(std::exception_ptr exception)
+    {
+        NFCResult result   = failure(NFC_ESOFT);
+        result.d_exception = std::move(exception);
+        return result;
+    }
+
+    /**
+     * \brief Get if the operation succeeded.
+     * \return True on success.
+     */
+    bool ok() const noexcept
+    {
+        return d_error >= 0;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return ok();
+    }
+
+    /**
+     * \brief Get the libnfc error code.
+     * \return The error code, NFC_SUCCESS on success.
+     */
+    int error() const noexcept
+    {
+        return d_error;
+    }
+
+    /**
+     * \brief Rethrow the exception that failed the operation, if any.
+     */
+    void rethrowException() const
+    {
+        if (d_exception)
+            std::rethrow_exception(d_exception);
+    }
+
+    /**
+     * \brief Get the value, throwing the error on failure.
+     * \return The value.
+     */
+    T &value()
+    {
+        if (!ok())
+            throwError();
+        return d_value;
+    }
+
+    /**
+     * \brief Get the value, throwing the error on failure.
+     * \return The value.
+     */
+    const T &value() const
+    {
+        if (!ok())
+            throwError();
+        return d_value;
+    }
+
+    /**
+     * \brief Get the error message.
+     * \return The error message, the exception one if an exception failed the
+     * operation.
+     */
+    std::string message() const
+    {
+        if (d_exception)
+            return getExceptionMessage(d_exception);
+        return getNFCErrorMessage(d_error);
+    }
+
+  private:
+    void throwError() const
+    {
+        rethrowException();
+        throwNFCError(d_error);
+    }
+
+    T d_value;
+    int d_error;
+    std::exception_ptr d_exception;
+};
+}
+
+#endif /* LOGICALACCESS_NFCRESULT_HPP */
@@ -0,0 +1,66 @@
+/**
+ * \file nfcsharedreaderprovider.cpp
+ * \brief NFC shared reader provider.
+ */
+
+#include <logicalaccess/plugins/readers/nfc/nfcsharedreaderprovider.hpp>
+#include <logicalaccess/myexception.hpp>
+
+#include <algorithm>
+
+namespace logicalaccess
+{
+#ifdef LLA_NFC_SHARED_READERS
+NFCSharedReaderProvider::NFCSharedReaderProvider(const std::string &socketPath)
+    : NFCReaderProvider()
+    , d_socket_path(socketPath)
+{
+}
+
+std::shared_ptr<NFCSharedReaderProvider>
+NFCSharedReaderProvider::createInstance(const std::string &socketPath)
+{
+    std::shared_ptr<NFCSharedReaderProvider> instance =
+        std::shared_ptr<NFCSharedReaderProvider>(new NFCSharedReaderProvider(socketPath));
+    instance->refreshReaderList();
+
+    return instance;
+}
+
+bool NFCSharedReaderProvider::refreshReaderList()
+{
+    nfc_connstring devices[NFC_SHARED_MAX_DEVICES];
+    size_t device_count =
+        nfc_shared_list_devices(d_socket_path.c_str(), devices, NFC_SHARED_MAX_DEVICES);
+    LOG(DEBUGS) << "Found " << device_count << " shared devices on " << d_socket_path
+                << ".";
+
+    // Readers of a stopped daemon are gone
+    d_readers.erase(
+        std::remove_if(d_readers.begin(), d_readers.end(),
+                       [&](std::shared_ptr<ReaderUnit> ru) {
+                           return std::none_of(devices, devices + device_count,
+                                               [&](const nfc_connstring &device) {
+                                                   return ru->getName() == device;
+                                               });
+                       }),
+        d_readers.end());
+
+    for (size_t i = 0; i < device_count; ++i)
+    {
+        auto itr = std::find_if(
+            d_readers.begin(), d_readers.end(),
+            [&](std::shared_ptr<ReaderUnit> ru) { return ru->getName() == devices[i]; });
+        if (itr == d_readers.end())
+        {
+            LOG(DEBUGS) << "Found shared reader{ " << devices[i] << " }";
+            std::shared_ptr<NFCReaderUnit> unit =
+                NFCReaderUnit::createNFCReaderUnit(devices[i]);
+            unit->setReaderProvider(std::weak_ptr<ReaderProvider>(shared_from_this()));
+            d_readers.push_back(unit);
+        }
+    }
+    return true;
+}
+#endif
+}
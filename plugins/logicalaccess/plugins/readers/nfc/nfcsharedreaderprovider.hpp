@@ -0,0 +1,84 @@
+/**
+ * \file nfcsharedreaderprovider.hpp
+ * \brief NFC shared reader provider.
+ */
+
+#ifndef LOGICALACCESS_READERNFC_SHAREDPROVIDER_HPP
+#define LOGICALACCESS_READERNFC_SHAREDPROVIDER_HPP
+
+#include <logicalaccess/plugins/readers/nfc/nfcreaderprovider.hpp>
+
+#ifdef LLA_NFC_SHARED_READERS
+#include <nfc/nfc-shared.h>
+#endif
+
+#include <string>
+
+namespace logicalaccess
+{
+#define READER_NFC_SHARED "NFCShared"
+
+#ifdef LLA_NFC_SHARED_READERS
+/**
+ * \brief NFC Shared Reader Provider class.
+ *
+ * Lists the readers served by an NFCReaderDaemon of another process. The
+ * reader units are plain NFCReaderUnit objects and are used like local ones.
+ */
+class LLA_READERS_NFC_NFC_API NFCSharedReaderProvider : public NFCReaderProvider
+{
+  public:
+    /**
+     * \brief Create a new NFC shared reader provider instance.
+     * \param socketPath The Unix socket of the daemon.
+     * \return The NFC shared reader provider instance.
+     */
+    static std::shared_ptr<NFCSharedReaderProvider>
+    createInstance(const std::string &socketPath = NFC_SHARED_DEFAULT_SOCKET);
+
+    /**
+     * \brief Get the reader provider type.
+     * \return The reader provider type.
+     */
+    std::string getRPType() const override
+    {
+        return READER_NFC_SHARED;
+    }
+
+    /**
+     * \brief Get the reader provider name.
+     * \return The reader provider name.
+     */
+    std::string getRPName() const override
+    {
+        return "NFC Shared";
+    }
+
+    /**
+     * \brief List the readers of the daemon.
+     * \return True if the list was updated, false otherwise.
+     */
+    bool refreshReaderList() override;
+
+    /**
+     * \brief Get the Unix socket of the daemon.
+     * \return The socket path.
+     */
+    const std::string &getSocketPath() const
+    {
+        return d_socket_path;
+    }
+
+  protected:
+    /**
+     * \brief Constructor.
+     * \param socketPath The Unix socket of the daemon.
+     */
+    explicit NFCSharedReaderProvider(const std::string &socketPath);
+
+    std::string d_socket_path;
+};
+#endif
+}
+
+#endif /* LOGICALACCESS_READERNFC_SHAREDPROVIDER_HPP */
@@ -58,6 +58,55 @@ NFCReaderCardAdapter::sendCommand(const std::vector<unsigned char> &command, lon
     return res;
 }
 
+NFCBatchResult NFCReaderCardAdapter::sendCommands(const std::vector<NFCBatchStep> &steps,
+                                                  long timeout)
+{
+    std::shared_ptr<NFCDataTransport> dt =
+        std::dynamic_pointer_cast<NFCDataTransport>(d_dataTransport);
+    if (dt)
+    {
+        return dt->sendCommands(steps, timeout);
+    }
+
+    NFCBatchResult result;
+    result.succeeded = 0;
+    result.error     = 0;
+    if (!d_dataTransport)
+    {
+        LOG(LogLevel::ERRORS)
+            << "Cannot transmit the commands, data transport is not set!";
+        return result;
+    }
+    for (const NFCBatchStep &step : steps)
+    {
+        // Raw commands, failures stop the batch like on the NFC data transport
+        std::vector<unsigned char> res;
+        try
+        {
+            d_dataTransport->send(step.command);
+            res = d_dataTransport->receive(timeout);
+        }
+        catch (std::exception &ex)
+        {
+            LOG(LogLevel::ERRORS) << "Batch stopped: " << ex.what();
+            result.error = NFC_EIO;
+            break;
+        }
+        result.data.insert(result.data.end(), res.begin(), res.end());
+        result.ends.push_back(result.data.size());
+
+        if (step.accepts(res.data(), res.size()))
+        {
+            ++result.succeeded;
+        }
+        else if (step.onUnexpectedStatus == NFC_BATCH_STOP)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
 bool NFCReaderCardAdapter::ignoreAllError(bool ignore)
 {
     bool tmp      = ignore_error_;
@@ -9,6 +9,7 @@
 
 #include <logicalaccess/plugins/cards/iso7816/readercardadapters/iso7816readercardadapter.hpp>
 #include <logicalaccess/plugins/readers/nfc/nfcreaderprovider.hpp>
+#include <logicalaccess/plugins/readers/nfc/nfcdatatransport.hpp>
 
 #include <string>
 #include <vector>
@@ -55,6 +56,20 @@ class LLA_READERS_NFC_NFC_API NFCReaderCardAdapter : public ISO7816ReaderCardAda
     std::vector<unsigned char> sendCommand(const std::vector<unsigned char> &command,
                                            long timeout = 3000) override;
 
+    /**
+     * \brief Send commands back to back, without the per command overhead.
+     * \param steps The commands, with their expected status and what to do
+     * when another status is answered.
+     * \param timeout The timeout of each command.
+     * \return The responses of the steps sent.
+     *
+     * Commands are neither adapted nor checked by the result checker. On a data
+     * transport other than NFC, they are sent one by one through its send() and
+     * receive(), and a failure stops the batch with NFC_EIO as error.
+     */
+    NFCBatchResult sendCommands(const std::vector<NFCBatchStep> &steps,
+                                long timeout = 3000);
+
     /**
      * Set the Ignore All Error flag to `ignore`.
      *